@@ -27,6 +27,9 @@ cd ..
 
 benchmarks-build/N-Body-Simulation --CL_Kernel_Path kernels/ --Kernel nbody.cl --Device CPU --Benchmark SHORT
 
+# Run the OpenMP thread-scaling study (strong and weak scaling)
+benchmarks-build/nbody_bench --ScalingStudy 4096 --Bind close --Output benchmarks/scaling.json
+
 # Clean up
 rm -r benchmarks-build/
 mkdir -p benchmarks-build/
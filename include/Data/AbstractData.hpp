@@ -10,7 +10,7 @@
  */
 
 #ifndef __N_BODY_SIMULATION_ABSTRACTDATA_HPP__
-#define __N_BODY_SIMULATION_ABSTRACTDATA_HPP_
+#define __N_BODY_SIMULATION_ABSTRACTDATA_HPP__
 
 
 #include "Float3.hpp"
@@ -50,18 +50,23 @@ public:
     std::size_t getSize() const;//!< Returns the amount of bodies used in the simulation
     std::size_t getBytesCount() const;
 
-    std::vector<float3> getPositions(); //!< Returns positions array
-    std::vector<float3> getVelocities();//!< Returns velocities array
+    const std::vector<float3> &getPositions() const; //!< Returns positions array
+    const std::vector<float3> &getVelocities() const;//!< Returns velocities array
 
     std::vector<float> getMasses() const;//!< Returns the mass array
 
     virtual std::vector<float> getFlatPositions() = 0; //!< Returns the flattened positions
     virtual std::vector<float> getFlatVelocities() = 0;//!< Returns the flattened velocities
+    void writeFlatPositions(float *destination) const; //!< Writes the flattened positions directly into destination (e.g. mapped memory)
+    void writeFlatVelocities(float *destination) const;//!< Writes the flattened velocities directly into destination (e.g. mapped memory)
+    void readFlatPositions(const float *source);       //!< Replaces the positions with flattened positions (e.g. read back from the GPU)
+    void readFlatVelocities(const float *source);      //!< Replaces the velocities with flattened velocities (e.g. read back from the GPU)
     double getMaxPosition() const;                     //!< Returns the largest possible position value (required for the Vertex Shader)
     virtual double getMaxMass() const = 0;             //!< Returns the largest possible mass
     double getMinMass() const;                         //!< Returns the lowest possible mass
 
-    friend double simulateCPU();
+    friend double simulateCPU(std::size_t steps);
+    friend void writeSnapshot(const std::string &fileName, const AbstractData &data, std::size_t step, double dt, double gravitationalConstant);
 };
 
 
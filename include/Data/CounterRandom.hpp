@@ -0,0 +1,74 @@
+/**
+ * @file CounterRandom.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains a counter-based random number generator for reproducible parallel initialization
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_COUNTERRANDOM_HPP__
+#define __N_BODY_SIMULATION_COUNTERRANDOM_HPP__
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Random numbers computed from (seed, stream, counter) with the SplitMix64 mixing function
+ *
+ * Every body uses its index as stream, so its values depend only on the seed and the index: the bodies can be
+ * generated by any number of threads in any order and the result is always bit-identical.
+ */
+class CounterRandom {
+private:
+    uint64_t key;
+    uint64_t counter = 0;
+
+public:
+    static uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    /**
+     * @brief Creates the generator of a stream
+     *
+     * @param seed seed of the whole data set
+     * @param stream index of the stream (e.g. of the body)
+     */
+    CounterRandom(uint64_t seed, uint64_t stream) : key(mix(seed ^ mix(stream + 0x9e3779b97f4a7c15ULL))) {
+    }
+
+    uint64_t next() {
+        return mix(key + ++counter * 0x9e3779b97f4a7c15ULL);
+    }
+
+    /**
+     * @brief Uniformly distributed in [0, 1)
+     */
+    double uniform() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * @brief Uniformly distributed in [minimum, maximum)
+     */
+    double uniform(double minimum, double maximum) {
+        return minimum + (maximum - minimum) * uniform();
+    }
+
+    /**
+     * @brief Normally distributed (Box-Muller)
+     */
+    double normal(double mean, double standardDeviation) {
+        const double twoPi = 6.283185307179586;
+        double u = 1.0 - uniform();
+        return mean + standardDeviation * std::sqrt(-2.0 * std::log(u)) * std::cos(twoPi * uniform());
+    }
+};
+
+
+#endif
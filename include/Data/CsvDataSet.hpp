@@ -0,0 +1,41 @@
+/**
+ * @file CsvDataSet.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the importer of initial conditions from CSV files
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_CSVDATASET_HPP__
+#define __N_BODY_SIMULATION_CSVDATASET_HPP__
+
+#include "AbstractData.hpp"
+
+#include <string>
+
+/**
+ * @brief Reads bodies from a CSV file with the columns x, y, z, vx, vy, vz, m (SI units)
+ *
+ * Empty lines, lines starting with '#' and a header line are skipped. The file is memory-mapped and split into one
+ * block per thread at line boundaries; every thread counts the bodies of its block first, so that all blocks can
+ * then be parsed in parallel directly into their place. Throws std::runtime_error with the line number if the file
+ * can't be read or a line is malformed.
+ *
+ * Parsing text is still much slower than mapping the binary format, so loadCsvDataSet() converts a CSV file only
+ * once into a snapshot file, which SnapshotDataSet loads.
+ */
+class CsvDataSet : public AbstractData {
+public:
+    explicit CsvDataSet(const std::string &fileName);
+    std::vector<float> getFlatPositions() override;
+    std::vector<float> getFlatVelocities() override;
+    double getMaxMass() const override;
+};
+
+AbstractData *loadCsvDataSet(const std::string &fileName, double dt, double gravitationalConstant);
+
+
+#endif
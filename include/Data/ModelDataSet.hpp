@@ -0,0 +1,45 @@
+/**
+ * @file ModelDataSet.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains data sets sampled from equilibrium models of star clusters and galaxies
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_MODELDATASET_HPP__
+#define __N_BODY_SIMULATION_MODELDATASET_HPP__
+
+#include "AbstractData.hpp"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Density models of ModelDataSet
+ */
+enum class Model { PLUMMER,  //!< Plummer sphere with isotropic velocities from its distribution function (truncated at 20 a)
+                   HERNQUIST,//!< Hernquist sphere with isotropic Gaussian velocities from the Jeans equation (truncated at 200 a)
+                   DISK };   //!< Cold exponential disk (scale height 0.05 a) on circular orbits (truncated at 10 a)
+
+bool parseModel(const std::string &name, Model &model);
+
+/**
+ * @brief Bodies of equal mass sampled from a model in (approximate) virial equilibrium
+ *
+ * Equilibrium initial conditions don't relax violently during the first steps like uniformly random velocities do.
+ * Every body is drawn from its own CounterRandom stream, so the bodies are generated in parallel and the same seed
+ * always gives bit-identical bodies. The center of mass is moved to rest at the origin.
+ */
+class ModelDataSet : public AbstractData {
+public:
+    ModelDataSet(Model model, std::size_t nbody, uint64_t seed, double totalMass, double scaleRadius, double gravitationalConstant);
+    std::vector<float> getFlatPositions() override;
+    std::vector<float> getFlatVelocities() override;
+    double getMaxMass() const override;
+};
+
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file Snapshot.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the binary snapshot format used for checkpoints and restarts
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_SNAPSHOT_HPP__
+#define __N_BODY_SIMULATION_SNAPSHOT_HPP__
+
+#include "AbstractData.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+const uint32_t snapshotVersion = 1;           //!< Incremented whenever the layout changes
+const std::size_t snapshotAlignment = 64;     //!< Alignment of the arrays in the file
+const char snapshotMagic[8] = {'N', 'B', 'O', 'D', 'Y', 'S', 'N', 'P'};
+
+/**
+ * @brief Integrators whose state can be stored in a snapshot
+ */
+enum class Integrator : uint32_t { SEMI_IMPLICIT_EULER = 0 };//!< v += a * dt, then x += v * dt (used by all engines; needs no state besides x and v)
+
+/**
+ * @brief Header at the beginning of a snapshot file (little endian)
+ *
+ * It is followed by the arrays x[N], y[N], z[N] of the positions, the same for the velocities and m[N],
+ * all as 32 bit floats starting at the given offsets, so they can be used directly from a memory-mapped file.
+ */
+struct SnapshotHeader {
+    char magic[8];               //!< "NBODYSNP"
+    uint32_t version;            //!< snapshotVersion of the writer
+    uint32_t headerSize;         //!< sizeof(SnapshotHeader) of the writer, so that later versions can append fields
+    uint64_t nbody;              //!< Number of bodies
+    uint64_t step;               //!< Number of steps simulated before the snapshot was taken
+    double time;                 //!< Simulated time in seconds
+    double dt;                   //!< Time step in seconds
+    double gravitationalConstant;//!< G used by the engines
+    uint32_t integrator;         //!< Integrator the state belongs to
+    uint32_t reserved;
+    double pMax;                 //!< Position range of the data set (used by the shader)
+    double pMin;
+    double vMax;                 //!< Velocity range of the data set
+    double vMin;
+    double mMax;                 //!< Mass range of the data set (used by the shader)
+    double mMin;
+    uint64_t positionsOffset;    //!< Byte offset of x[N], y[N], z[N]
+    uint64_t velocitiesOffset;   //!< Byte offset of vx[N], vy[N], vz[N]
+    uint64_t massesOffset;       //!< Byte offset of m[N]
+    uint64_t fileSize;           //!< Size of the complete file (detects truncated files)
+};
+
+void writeSnapshot(const std::string &fileName, const AbstractData &data, std::size_t step, double dt, double gravitationalConstant);
+
+
+#endif
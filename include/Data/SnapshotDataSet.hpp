@@ -0,0 +1,40 @@
+/**
+ * @file SnapshotDataSet.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Header File for data sets restored from snapshot files
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_SNAPSHOTDATASET_HPP__
+#define __N_BODY_SIMULATION_SNAPSHOTDATASET_HPP__
+
+#include "AbstractData.hpp"
+
+/**
+ * @brief Restores the bodies of a snapshot written by writeSnapshot()
+ *
+ * The file is memory-mapped and the arrays are copied into the body vectors in parallel, so even large snapshots
+ * are restored without parsing. Throws std::runtime_error if the file can't be read or is not a valid snapshot.
+ */
+class SnapshotDataSet : public AbstractData {
+private:
+    std::size_t step = 0;//!< Step the snapshot was taken at
+    double time = 0.0;   //!< Simulated time of the snapshot in seconds
+    double dt = 0.0;     //!< Time step the snapshot was simulated with
+
+public:
+    explicit SnapshotDataSet(const std::string &fileName);
+    std::vector<float> getFlatPositions() override;
+    std::vector<float> getFlatVelocities() override;
+    double getMaxMass() const override;
+    std::size_t getStep() const;
+    double getTime() const;
+    double getTimeStep() const;
+};
+
+
+#endif
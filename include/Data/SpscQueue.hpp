@@ -0,0 +1,88 @@
+/**
+ * @file SpscQueue.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains a lock-free single-producer single-consumer ring buffer
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_SPSCQUEUE_HPP__
+#define __N_BODY_SIMULATION_SPSCQUEUE_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Bounded queue for exactly one producer and one consumer thread
+ *
+ * Neither side ever waits: push() fails if the queue is full and pop() fails if it is empty. The indices are only
+ * written by their own side and published with release/acquire, and they live on separate cache lines so that the
+ * two threads don't invalidate each other's line on every operation.
+ *
+ * @tparam T element type (should be cheap to copy, e.g. a pointer or an index)
+ */
+template <typename T>
+class SpscQueue {
+private:
+    static const std::size_t cacheLine = 64;
+    std::vector<T> slots;
+    std::size_t mask;
+    alignas(cacheLine) std::atomic<std::size_t> head{0};//!< Next slot to read (written by the consumer)
+    alignas(cacheLine) std::atomic<std::size_t> tail{0};//!< Next slot to write (written by the producer)
+
+public:
+    /**
+     * @brief Creates a queue which can hold at least the given number of elements
+     *
+     * @param capacity minimum capacity (rounded up to a power of two)
+     */
+    explicit SpscQueue(std::size_t capacity) {
+        std::size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    /**
+     * @brief Appends an element (producer only)
+     *
+     * @return false if the queue is full
+     */
+    bool push(const T &value) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask)
+            return false;
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element (consumer only)
+     *
+     * @return false if the queue is empty
+     */
+    bool pop(T &value) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Whether the queue is empty (exact only on the consumer side)
+     */
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+
+#endif
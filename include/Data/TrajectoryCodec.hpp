@@ -0,0 +1,103 @@
+/**
+ * @file TrajectoryCodec.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the lossy codec of compressed trajectory frames
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_TRAJECTORYCODEC_HPP__
+#define __N_BODY_SIMULATION_TRAJECTORYCODEC_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const uint32_t trajectoryChunkBodies = 16384;//!< Bodies per independently coded chunk
+const uint32_t trajectoryProbabilityBits = 12;//!< Precision of the rANS frequency tables
+
+/**
+ * @brief Coding parameters at the beginning of every compressed frame (little endian)
+ *
+ * A keyframe is followed by the permutation stream (original index of every body in Morton order) and the value
+ * stream; other frames only contain the value stream. A stream starts with chunkCount uint32 chunk sizes followed
+ * by the chunks. Chunk c holds the bodies [c * trajectoryChunkBodies, (c + 1) * trajectoryChunkBodies) in Morton
+ * order of the last keyframe, component by component (position x, y, z, then velocity x, y, z). Every chunk can be
+ * decoded on its own.
+ */
+struct TrajectoryFrameCoding {
+    uint32_t keyframe;         //!< 1 if the frame doesn't depend on the previous one
+    uint32_t chunkCount;       //!< Number of chunks of every stream
+    double positionOrigin[3];  //!< Position of the quantized value 0
+    double positionQuantum;    //!< Distance between two quantized positions
+    double velocityOrigin[3];  //!< Velocity of the quantized value 0
+    double velocityQuantum;    //!< Distance between two quantized velocities
+};
+
+/**
+ * @brief Header of a chunk, followed by the frequency table (rANS only) and the coded bytes
+ *
+ * The values of a chunk are zigzag coded varints. Keyframes store the difference to the previous body of the chunk,
+ * other frames the difference to the same body in the previous frame. The varint bytes are then coded by an
+ * order-0 byte-wise rANS coder, unless that doesn't make them smaller.
+ */
+struct TrajectoryChunkHeader {
+    uint32_t rawBytes;  //!< Number of varint bytes
+    uint32_t codedBytes;//!< Number of bytes after the frequency table
+    uint32_t mode;      //!< 0: varint bytes are stored, 1: rANS coded with 256 uint16 frequencies
+};
+
+/**
+ * @brief Quantizes frames to an error bound and codes them relative to the previous frame
+ *
+ * The error bound is relative to the largest extent of the bounding box of the bodies at the last keyframe, so
+ * every reconstructed coordinate (and velocity component) is at most relativeError * extent away from the original
+ * value, apart from the rounding to float. Keyframes sort the bodies along a Morton curve, so that a chunk contains
+ * spatially close bodies, and keep this order until the next keyframe. The encoder runs on the writer thread of the
+ * recorder while the simulation uses all cores, so it is serial; the chunks are only decoded in parallel.
+ */
+class TrajectoryEncoder {
+private:
+    std::size_t nbody;
+    int components;
+    double relativeError;
+    std::size_t keyframeInterval;
+    std::size_t frameCount = 0;
+    TrajectoryFrameCoding coding;
+    std::vector<uint32_t> permutation;          //!< Original index of every body in Morton order
+    std::vector<int64_t> current;               //!< Quantized values of the current frame (component-major, Morton order)
+    std::vector<int64_t> previous;              //!< Quantized values of the previous frame
+    std::vector<std::vector<char>> chunkBuffers;//!< Coded chunks of the current stream
+
+    void startKeyframe(const float *frame);
+    void encodeStream(const std::vector<int64_t> &values, const std::vector<int64_t> *reference, int streamComponents, std::vector<char> &out);
+
+public:
+    TrajectoryEncoder(std::size_t nbody, bool velocities, double relativeError, std::size_t keyframeInterval);
+    void encode(const float *frame, std::vector<char> &out);
+};
+
+/**
+ * @brief Reconstructs frames written by TrajectoryEncoder
+ *
+ * Frames have to be decoded in the order they were written, starting at a keyframe.
+ */
+class TrajectoryDecoder {
+private:
+    std::size_t nbody;
+    int components;
+    bool hasKeyframe = false;
+    std::vector<uint32_t> permutation;
+    std::vector<int64_t> values;//!< Quantized values of the last frame (component-major, Morton order)
+
+public:
+    TrajectoryDecoder(std::size_t nbody, bool velocities);
+    static bool isKeyframe(const char *data, std::size_t size);
+    void decode(const char *data, std::size_t size, float *frame);
+};
+
+
+#endif
@@ -0,0 +1,127 @@
+/**
+ * @file TrajectoryRecorder.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains a recorder which streams trajectories to a binary file on a background thread
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_TRAJECTORYRECORDER_HPP__
+#define __N_BODY_SIMULATION_TRAJECTORYRECORDER_HPP__
+
+#include "AbstractData.hpp"
+#include "SpscQueue.hpp"
+#include "TrajectoryCodec.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+const uint32_t trajectoryVersion = 2;
+const char trajectoryMagic[8] = {'N', 'B', 'O', 'D', 'Y', 'T', 'R', 'J'};
+const char trajectoryIndexMagic[8] = {'N', 'B', 'O', 'D', 'Y', 'I', 'D', 'X'};
+const uint32_t trajectoryHasVelocities = 1;//!< Flag of TrajectoryHeader::flags
+const uint32_t trajectoryCompressed = 2;   //!< Flag of TrajectoryHeader::flags
+
+/**
+ * @brief Header at the beginning of a trajectory file (little endian)
+ *
+ * It is followed by frames of frameBytes bytes each: a TrajectoryFrameHeader, the positions as 3 * nbody floats
+ * (x, y, z per body) and, if the velocities flag is set, the velocities in the same layout. If the compressed flag
+ * is set, the frames have different sizes and the TrajectoryFrameHeader is followed by a frame of TrajectoryEncoder.
+ */
+struct TrajectoryHeader {
+    char magic[8];      //!< "NBODYTRJ"
+    uint32_t version;   //!< trajectoryVersion of the writer
+    uint32_t headerSize;//!< sizeof(TrajectoryHeader) of the writer
+    uint64_t nbody;     //!< Number of bodies
+    uint32_t flags;     //!< trajectoryHasVelocities
+    uint32_t reserved;
+    double dt;          //!< Time step of the simulation in seconds
+    uint64_t frameBytes;//!< Size of a frame including its header (0 if compressed)
+    double relativeError;     //!< Error bound of the compressed positions and velocities (0 if not compressed)
+    uint32_t keyframeInterval;//!< Number of frames between two compressed keyframes
+    uint32_t chunkBodies;     //!< trajectoryChunkBodies of the writer
+};
+
+/**
+ * @brief Header of every frame
+ */
+struct TrajectoryFrameHeader {
+    uint64_t step;        //!< Simulation step of the frame
+    uint64_t payloadBytes;//!< Number of bytes following this header
+};
+
+/**
+ * @brief Last bytes of a completely written trajectory file
+ *
+ * It follows an index of frameCount (step, offset) pairs of uint64_t. A file without footer (e.g. after a crash)
+ * can still be read frame by frame using the payload sizes of the frame headers.
+ */
+struct TrajectoryFooter {
+    uint64_t frameCount;   //!< Number of frames in the file
+    uint64_t indexOffset;  //!< Byte offset of the index
+    uint64_t droppedFrames;//!< Frames which were dropped because the writer fell behind
+    char magic[8];         //!< "NBODYIDX"
+};
+
+/**
+ * @brief What record() does if all buffers are waiting to be written
+ */
+enum class TrajectoryPolicy { DROP, //!< The frame is dropped and counted; the simulation never waits
+                              BLOCK };//!< The simulation waits until the writer has freed a buffer (back-pressure)
+
+/**
+ * @brief Streams positions (and optionally velocities) to a trajectory file
+ *
+ * record() copies a frame into one of a fixed number of pre-allocated buffers and hands it to a writer thread
+ * through a lock-free queue; the writer returns written buffers through a second queue. So the calling thread
+ * never touches the file and never allocates memory. The index and footer are written by the destructor.
+ * Compressed frames are encoded by the writer thread as well.
+ */
+class TrajectoryRecorder {
+private:
+    /**
+     * @brief A pre-allocated frame buffer
+     */
+    struct Frame {
+        TrajectoryFrameHeader header;
+        std::vector<float> data;
+    };
+
+    std::size_t nbody;
+    bool velocities;
+    TrajectoryPolicy policy;
+    std::vector<Frame> frames;
+    SpscQueue<Frame *> filledFrames;//!< Frames waiting to be written (simulation -> writer)
+    SpscQueue<Frame *> freeFrames;  //!< Frames which can be filled again (writer -> simulation)
+    std::ofstream file;
+    std::vector<uint64_t> index;         //!< Step and offset of every written frame (only used by the writer)
+    std::unique_ptr<TrajectoryEncoder> encoder;//!< Compresses the frames if an error bound is given (only used by the writer)
+    std::vector<char> encoded;                 //!< Last compressed frame
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> failed{false};     //!< Set by the writer if the file couldn't be written
+    std::atomic<std::size_t> droppedFrames{0};
+    std::thread writer;
+
+    void writeLoop();
+
+public:
+    TrajectoryRecorder(const std::string &fileName, std::size_t nbody, double dt, bool velocities, std::size_t bufferCount, TrajectoryPolicy policy,
+                       double relativeError = 0, std::size_t keyframeInterval = 64);
+    ~TrajectoryRecorder();
+    TrajectoryRecorder(const TrajectoryRecorder &) = delete;
+    TrajectoryRecorder &operator=(const TrajectoryRecorder &) = delete;
+    bool record(std::size_t step, const AbstractData &data);
+    std::size_t getDroppedFrames() const;
+};
+
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file TripleBuffer.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains a lock-free triple buffer which hands the latest state from one thread to another
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_TRIPLEBUFFER_HPP__
+#define __N_BODY_SIMULATION_TRIPLEBUFFER_HPP__
+
+#include <atomic>
+
+/**
+ * @brief Distributes three slots between exactly one writer and one reader thread
+ *
+ * The writer fills its back slot and publishes it, the reader always switches to the most recently published slot.
+ * Neither side ever waits: a slot which has been published but not picked up yet is simply replaced by the next one.
+ * Only the indices of the slots are managed, so the slots can be anything that can be indexed (host arrays, OpenGL
+ * buffers, ...). The index of the slot in the middle is exchanged atomically together with a flag telling whether it
+ * contains a state which the reader hasn't seen yet.
+ */
+class TripleBuffer {
+private:
+    static const unsigned fresh = 4;//!< Flag of the middle slot if it has been published after the last update()
+    unsigned backSlot = 0;          //!< Slot written by the writer
+    std::atomic<unsigned> middle{1};//!< Slot exchanged between both sides (and the flag fresh)
+    unsigned frontSlot = 2;         //!< Slot read by the reader
+
+public:
+    /**
+     * @brief Slot which the writer fills next (writer only)
+     */
+    unsigned back() const {
+        return backSlot;
+    }
+
+    /**
+     * @brief Hands the back slot to the reader and takes the previous middle slot as new back slot (writer only)
+     */
+    void publish() {
+        backSlot = middle.exchange(backSlot | fresh, std::memory_order_acq_rel) & ~fresh;
+    }
+
+    /**
+     * @brief Whether a slot has been published since the last update() (reader only)
+     */
+    bool hasUpdate() const {
+        return (middle.load(std::memory_order_acquire) & fresh) != 0;
+    }
+
+    /**
+     * @brief Switches to the latest published slot (reader only)
+     *
+     * The previous front slot is handed to the writer, so the reader must have stopped using it.
+     *
+     * @return false if nothing has been published since the last update(); the front slot is kept then
+     */
+    bool update() {
+        if (!hasUpdate())
+            return false;
+        frontSlot = middle.exchange(frontSlot, std::memory_order_acq_rel) & ~fresh;
+        return true;
+    }
+
+    /**
+     * @brief Slot which contains the latest state the reader has switched to (reader only)
+     */
+    unsigned front() const {
+        return frontSlot;
+    }
+};
+
+
+#endif
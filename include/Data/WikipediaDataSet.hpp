@@ -14,6 +14,8 @@
 
 #include "AbstractData.hpp"
 
+#include <cstdint>
+
 /**
  * @brief Implements the Wikipedia Dataset as found here: https://en.wikipedia.org/wiki/N-body_simulation#Initialisation_of_Simulation_Parameters
  * 
@@ -21,7 +23,7 @@
 class WikipediaDataSet : public AbstractData {
 
 public:
-    WikipediaDataSet(const std::size_t numberRandomObjects = 0, std::string initDistribution = "normal", const double mMax = 1e20, const double mMin = 1e10, const double pMax = 5e12, const double pMin = 0, const double vMax = 5e3, const double vMin = 0);
+    WikipediaDataSet(const std::size_t numberRandomObjects = 0, std::string initDistribution = "normal", const uint64_t seed = 0, const double mMax = 1e20, const double mMin = 1e10, const double pMax = 5e12, const double pMin = 0, const double vMax = 5e3, const double vMin = 0);
     std::vector<float> getFlatPositions() override;
     std::vector<float> getFlatVelocities() override;
     double getMaxMass() const override;
@@ -0,0 +1,60 @@
+/**
+* @file BenchmarkController.hpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a class which decides how long a benchmark run is warmed up and measured
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#ifndef N_BODY_SIMULATION_BENCHMARKCONTROLLER_H
+#define N_BODY_SIMULATION_BENCHMARKCONTROLLER_H
+
+#include "../../lib/Core/Time.hpp"
+#include "../../lib/Core/TimeSpan.hpp"
+#include "PerformanceMetric.hpp"
+
+#include <deque>
+
+/**
+ * @brief Decides when the warm-up of a benchmark run is over and when enough samples have been measured.
+ *
+ * The warm-up ends as soon as the step times of a rolling window are steady, i.e. the drift between the older and the
+ * newer half of the window is small compared to the mean and to the rolling variance. Afterwards samples are taken
+ * until the 95 % confidence interval of the mean is narrower than the target width relative to the mean.
+ * A time budget bounds both phases, so slow configurations end with fewer samples (and a wider interval) instead of running for hours.
+ */
+class BenchmarkController {
+public:
+    enum class State { WARM_UP,
+                       MEASURING,
+                       DONE };
+
+private:
+    double targetRelativeWidth;//!< Target half width of the confidence interval relative to the mean
+    double timeBudget;         //!< Maximum duration of warm-up and measurement in seconds
+    std::size_t windowSize;    //!< Number of samples used for the steady state detection
+    double steadyThreshold;    //!< Relative drift of a window which is always considered steady
+    std::size_t minSamples;    //!< Minimum number of measured samples
+
+    State state = State::WARM_UP;
+    std::deque<double> window;//!< Last samples of the warm-up
+    std::size_t warmUpSteps = 0;
+    bool converged = false;
+    PerformanceMetric measured;//!< Samples taken after the warm-up
+    Core::TimeSpan startTime = Core::getCurrentTime();
+
+    bool isSteady() const;
+
+public:
+    BenchmarkController(double targetRelativeWidth, double timeBudget, std::size_t windowSize = 20, double steadyThreshold = 0.05, std::size_t minSamples = 5);
+    State addSample(double t);
+    State getState() const;
+    std::size_t getWarmUpSteps() const;
+    bool hasConverged() const;
+    const PerformanceMetric &getMeasured() const;
+};
+
+#endif//N_BODY_SIMULATION_BENCHMARKCONTROLLER_H
@@ -0,0 +1,84 @@
+/**
+* @file PerfCounters.hpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains hardware performance counters for the CPU force calculation (Linux perf_event_open)
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#ifndef N_BODY_SIMULATION_PERFCOUNTERS_H
+#define N_BODY_SIMULATION_PERFCOUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Counters which are reported; FP_OPS is the sum of the packed and scalar single precision FP events weighted with their lane count
+ */
+enum class Counter { CYCLES,
+                     INSTRUCTIONS,
+                     CACHE_MISSES,
+                     BRANCH_MISSES,
+                     FP_OPS,
+                     COUNT };
+
+/**
+ * @brief Counter values summed over all threads and measured regions.
+ */
+struct CounterValues {
+    double values[static_cast<std::size_t>(Counter::COUNT)] = {};
+    bool valid[static_cast<std::size_t>(Counter::COUNT)] = {};//!< Whether the counter could be opened
+    std::size_t regions = 0;                                   //!< Number of measured force phases (one per step)
+    std::size_t threads = 0;                                   //!< Largest number of threads which contributed to a region
+
+    CounterValues &operator+=(const CounterValues &other);
+    bool isValid(Counter counter) const;
+    double get(Counter counter) const;
+    double getIpc() const;
+    double getPerInteraction(Counter counter, std::size_t nbody) const;
+};
+
+/**
+ * @brief Hardware performance counters (enabled with --PerfCounters).
+ *
+ * Every thread opens its own counter groups on first use; a PerfCounterScope reads them at its start and end and
+ * adds the difference to totals shared by all threads. If perf_event_open is not permitted (e.g. in containers or
+ * with a restrictive perf_event_paranoid) or the system is not Linux, enable() prints the reason and counting stays off.
+ */
+namespace PerfCounters {
+    const std::size_t maxGroups = 2; //!< Generic events and the FP events (the latter only on Intel CPUs)
+    const std::size_t maxEvents = 8; //!< Events of all groups
+
+    /**
+     * @brief Raw counter readings of the calling thread
+     */
+    struct Snapshot {
+        uint64_t values[maxEvents] = {};
+        uint64_t timeEnabled[maxGroups] = {};//!< Used to scale the values if the groups had to be multiplexed
+        uint64_t timeRunning[maxGroups] = {};
+    };
+
+    bool enable();
+    bool isEnabled();
+    CounterValues collect();
+}// namespace PerfCounters
+
+/**
+ * @brief Counts the events of the calling thread between its construction and destruction.
+ */
+class PerfCounterScope {
+private:
+    PerfCounters::Snapshot start;
+    bool active = false;
+
+public:
+    PerfCounterScope();
+    ~PerfCounterScope();
+    PerfCounterScope(const PerfCounterScope &) = delete;
+    PerfCounterScope &operator=(const PerfCounterScope &) = delete;
+};
+
+#endif//N_BODY_SIMULATION_PERFCOUNTERS_H
@@ -12,14 +12,35 @@
 #ifndef N_BODY_SIMULATION_PERFORMANCEMETRICS_H
 #define N_BODY_SIMULATION_PERFORMANCEMETRICS_H
 
+#include <cstdint>
 #include <limits>
 #include <string>
 #include <vector>
 
+/**
+ * @brief Streaming statistics of a time measurement.
+ *
+ * Samples are not stored. Mean and variance are updated with Welford's algorithm and the
+ * distribution is kept in a histogram with logarithmic buckets (in the style of HdrHistogram):
+ * every power of two is split into 2^subBucketBits linear sub-buckets, so percentiles have a
+ * relative error below 2^-subBucketBits. The number of buckets only depends on the largest
+ * sample, not on the number of samples.
+ */
 class PerformanceMetric {
 
 private:
-    std::vector<double> times;
+    static const unsigned subBucketBits = 6;                          //!< 64 sub-buckets per power of two (< 1.6 % error)
+    static const uint64_t subBucketCount = uint64_t(1) << subBucketBits;//!< Number of sub-buckets per power of two
+
+    std::vector<uint64_t> buckets;                         //!< Histogram of the samples in nanoseconds
+    std::size_t count = 0;                                 //!< Number of samples
+    double mean = 0.0;                                     //!< Running mean (Welford)
+    double m2 = 0.0;                                       //!< Running sum of squared differences to the mean (Welford)
+    double minTime = std::numeric_limits<double>::max();   //!< Smallest sample
+    double maxTime = std::numeric_limits<double>::lowest();//!< Largest sample
+
+    static std::size_t getBucketIndex(uint64_t nanoseconds);
+    static double getBucketValue(std::size_t index);
 
 public:
     PerformanceMetric();
@@ -27,6 +48,11 @@ public:
     double getMinTime() const;// in seconds
     double getMaxTime() const;// in seconds
     double getAvgTime() const;// in seconds
+    double getStdDev() const; // in seconds
+    double getCoefficientOfVariation() const;
+    double getConfidenceHalfWidth() const;// 95 % confidence interval of the mean, in seconds
+    double getPercentile(double percentile) const;// percentile in [0, 100], result in seconds
+    std::size_t getCount() const;
 };
 
 #endif//N_BODY_SIMULATION_PERFORMANCEMETRICS_H
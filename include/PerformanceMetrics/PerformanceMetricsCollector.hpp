@@ -14,26 +14,67 @@
 
 #include "../../lib/Core/Time.hpp"
 #include "../../lib/Core/TimeSpan.hpp"
+#include "PerfCounters.hpp"
 #include "PerformanceMetric.hpp"
 
+#include <cstdint>
+#include <ostream>
+
 enum class BenchmarkMode { OFF,
                            SHORT,
                            LONG };
 
+/**
+ * @brief Phases of a frame which are timed separately; the order defines the order of the CSV columns
+ */
+enum class Phase { GL_FINISH,
+                   GL_ACQUIRE,
+                   WRITE_POSITIONS,
+                   WRITE_VELOCITIES,
+                   FORCE_KERNEL,
+                   UPDATE_KERNEL,
+                   READ_POSITIONS,
+                   GL_RELEASE,
+                   CPU_FORCE,
+                   CPU_UPDATE,
+                   VBO_UPLOAD,
+                   VALIDATION,
+                   DIAGNOSTICS,
+                   DRAW,
+                   COUNT };
+
 class PerformanceMetricsCollector {
 private:
     PerformanceMetric calcTimes;
     PerformanceMetric renderTimes;
+    std::vector<PerformanceMetric> phaseTimes;       //!< Duration of each phase (end - start for OpenCL commands)
+    std::vector<PerformanceMetric> phaseQueueDelays; //!< Time an OpenCL command waited in the host queue (submit - queued)
+    std::vector<PerformanceMetric> phaseLaunchDelays;//!< Time between submission and execution of an OpenCL command (start - submit)
     Core::TimeSpan lastTime = Core::getCurrentTime();
+    std::size_t warmUpSteps = 0;//!< Number of steps before the measurement started (benchmark mode)
+    bool converged = false;     //!< Whether the confidence interval reached its target width (benchmark mode)
+    CounterValues counters;     //!< Hardware counters of the CPU force phases (--PerfCounters)
     static std::string getCPUModel();
+    static void writeDistribution(std::ostream &logFile, const PerformanceMetric &metric);
 
 public:
     PerformanceMetricsCollector();
     void addCalcTime(double t);
-    void printResult();
-    void writeToLogFile(const std::string &logFileName, size_t nbody) const;
+    void setBenchmarkStatus(std::size_t warmUpSteps, bool converged);
+    void addPhaseTime(Phase phase, double t);
+    void addPhaseEvent(Phase phase, uint64_t queued, uint64_t submit, uint64_t start, uint64_t end);
+    void addCounters(const CounterValues &values);
+    static const char *getPhaseName(Phase phase);
+    static bool isDevicePhase(Phase phase);
+    double getInteractionsPerSecond(size_t nbody) const;
+    double getGflops(size_t nbody) const;
+    double getBandwidth(size_t nbody) const;
+    void printResult(size_t nbody);
+    void writeToLogFile(const std::string &logFileName, size_t nbody, size_t repetition = 0) const;
     static std::string initLogFile();
-    PerformanceMetric getCalcTimes() const;
+    static std::string getTimeStamp();
+    const PerformanceMetric &getCalcTimes() const;
+    const CounterValues &getCounters() const;
 };
 
 
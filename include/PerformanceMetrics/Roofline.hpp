@@ -0,0 +1,40 @@
+/**
+* @file Roofline.hpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains the work model of a simulation step and microbenchmarks for the peak performance of the host
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#ifndef N_BODY_SIMULATION_ROOFLINE_H
+#define N_BODY_SIMULATION_ROOFLINE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Floating point operations counted per body-body interaction.
+ *
+ * The usual convention for direct N-body codes: 3 subtractions for the distance vector,
+ * 5 for the squared distance, 4 for the reciprocal square root, 2 for the force factor
+ * and 6 for accumulating the acceleration.
+ */
+const double flopsPerInteraction = 20.0;
+
+/**
+ * @brief Peak performance of a device measured with microbenchmarks.
+ */
+struct PeakPerformance {
+    double gflops = 0.0;   //!< Attained single precision GFLOP/s of a multiply-add loop
+    double bandwidth = 0.0;//!< Attained memory bandwidth in GB/s of a streaming kernel
+    std::string source;    //!< Device the values have been measured on
+};
+
+double getInteractionsPerStep(std::size_t nbody);
+double getBytesPerStep(std::size_t nbody);
+PeakPerformance measureHostPeak();
+
+#endif//N_BODY_SIMULATION_ROOFLINE_H
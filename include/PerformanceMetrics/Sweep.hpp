@@ -0,0 +1,21 @@
+/**
+* @file Sweep.hpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a parser for the body counts of a benchmark sweep
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#ifndef N_BODY_SIMULATION_SWEEP_H
+#define N_BODY_SIMULATION_SWEEP_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+std::vector<std::size_t> parseSweep(const std::string &sweep);
+
+#endif//N_BODY_SIMULATION_SWEEP_H
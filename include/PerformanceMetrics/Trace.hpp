@@ -0,0 +1,56 @@
+/**
+* @file Trace.hpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a scoped-zone profiler which writes a timeline in the Chrome trace-event format
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#ifndef N_BODY_SIMULATION_TRACE_H
+#define N_BODY_SIMULATION_TRACE_H
+
+#include "../../lib/Core/Time.hpp"
+#include "../../lib/Core/TimeSpan.hpp"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Timeline profiler (enabled with --Trace).
+ *
+ * Every thread records its zones into its own ring buffer, so recording needs no lock. The buffers keep the
+ * latest events and are written to a JSON file in the Chrome trace-event format at the end, which can be
+ * opened with chrome://tracing or https://ui.perfetto.dev. OpenCL commands are shown on a separate track;
+ * their device timestamps are converted to the host clock with an offset measured by calibrateDeviceClock().
+ */
+namespace Trace {
+    void enable();
+    bool isEnabled();
+    void addZone(const char *name, const char *category, int64_t start, int64_t end);
+    void setDeviceClockOffset(int64_t offset);
+    void addDeviceZone(const char *name, uint64_t startNs, uint64_t endNs);
+    void writeTraceFile(const std::string &fileName);
+}// namespace Trace
+
+/**
+ * @brief Records the time between its construction and destruction as a zone of the calling thread.
+ *
+ * Name and category must be string literals (or live until the trace is written).
+ */
+class TraceZone {
+private:
+    const char *name;
+    const char *category;
+    int64_t start = 0;
+
+public:
+    TraceZone(const char *name, const char *category);
+    ~TraceZone();
+    TraceZone(const TraceZone &) = delete;
+    TraceZone &operator=(const TraceZone &) = delete;
+};
+
+#endif//N_BODY_SIMULATION_TRACE_H
@@ -0,0 +1,75 @@
+/**
+ * @file FrameExporter.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains an exporter which reads rendered frames back asynchronously and writes them as image sequence
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_FRAMEEXPORTER_HPP__
+#define __N_BODY_SIMULATION_FRAMEEXPORTER_HPP__
+
+#include "../Data/SpscQueue.hpp"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Exports the rendered frames as PPM images, either as numbered files or as stream to an encoder
+ *
+ * capture() only starts an asynchronous glReadPixels() into one of readbackDepth pixel buffers; a buffer is mapped
+ * readbackDepth frames later, when the GPU has long finished the copy. The pixels are handed to a writer thread
+ * through a lock-free queue like in TrajectoryRecorder, so neither the render loop nor the simulation waits for the
+ * disk or the encoder unless all frame buffers are queued. No frame is dropped, because a video needs all of them.
+ * All member functions have to be called with the OpenGL context current.
+ */
+class FrameExporter {
+private:
+    static const unsigned readbackDepth = 3;//!< Number of frames between glReadPixels() and mapping its buffer
+
+    /**
+     * @brief A pre-allocated frame buffer
+     */
+    struct Frame {
+        uint64_t number;
+        std::vector<uint8_t> pixels;//!< RGB rows from top to bottom
+    };
+
+    unsigned width;
+    unsigned height;
+    std::string prefix;      //!< Prefix of the file names (if no encoder is used)
+    FILE *encoder = nullptr; //!< Standard input of the encoder process
+    GLuint pixelBuffers[readbackDepth];
+    GLsync readbackFences[readbackDepth] = {nullptr, nullptr, nullptr};
+    uint64_t readbackNumbers[readbackDepth];//!< Frame number of the pending readback of a pixel buffer
+    unsigned nextBuffer = 0;
+    uint64_t capturedFrames = 0;
+    std::vector<Frame> frames;
+    SpscQueue<Frame *> filledFrames;//!< Frames waiting to be written (render -> writer)
+    SpscQueue<Frame *> freeFrames;  //!< Frames which can be filled again (writer -> render)
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> failed{false};//!< Set by the writer if a frame couldn't be written
+    std::thread writer;
+
+    void collect(unsigned buffer);
+    void writeLoop();
+
+public:
+    FrameExporter(const std::string &target, unsigned width, unsigned height, std::size_t bufferCount);
+    ~FrameExporter();
+    FrameExporter(const FrameExporter &) = delete;
+    FrameExporter &operator=(const FrameExporter &) = delete;
+    void capture();
+};
+
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file Offscreen.hpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the creation of an OpenGL context without window for nodes without X server
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __N_BODY_SIMULATION_OFFSCREEN_HPP__
+#define __N_BODY_SIMULATION_OFFSCREEN_HPP__
+
+bool createOffscreenContext(unsigned width, unsigned height);
+void destroyOffscreenContext();
+
+
+#endif
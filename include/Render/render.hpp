@@ -13,5 +13,9 @@
 
 void render();
 int openGlInit(int argc, char *argv[]);
+void uploadDataSet();
 void glutCleanup();
+void stopSimulationThread();
+void runOffscreenLoop();
+bool runBenchmarkLoop();
 #endif
\ No newline at end of file
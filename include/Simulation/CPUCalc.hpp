@@ -13,7 +13,9 @@
 #define __N_BODY_SIMULATION_CPUCALC_HPP__
 
 
-double simulateCPU();
+#include <cstddef>
+
+double simulateCPU(std::size_t steps = 1);
 
 
 #endif
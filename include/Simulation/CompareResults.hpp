@@ -12,8 +12,13 @@
 #ifndef N_BODY_SIMULATION_COMPARERESULTS_H
 #define N_BODY_SIMULATION_COMPARERESULTS_H
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 void compareResults();
+std::vector<int> selectValidationSample(std::size_t nrBodies, std::size_t sampleSize, uint64_t seed);
+void compareSampledResults(const std::vector<float> &gpuPositions, std::size_t step);
 
 
 #endif//N_BODY_SIMULATION_COMPARERESULTS_H
@@ -0,0 +1,38 @@
+/**
+* @file Diagnostics.hpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains declarations for conservation diagnostics (energy, momentum, center of mass and bounding box)
+* @version 1
+* @date 2022-02-09
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#ifndef N_BODY_SIMULATION_DIAGNOSTICS_HPP
+#define N_BODY_SIMULATION_DIAGNOSTICS_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Global quantities of the whole system at one point in time
+ */
+struct Diagnostics {
+    double kineticEnergy = 0.0;
+    double potentialEnergy = 0.0;
+    double totalMass = 0.0;
+    double momentum[3] = {0.0, 0.0, 0.0};
+    double angularMomentum[3] = {0.0, 0.0, 0.0};
+    double centerOfMass[3] = {0.0, 0.0, 0.0};
+    double boundsMin[3] = {0.0, 0.0, 0.0};
+    double boundsMax[3] = {0.0, 0.0, 0.0};
+};
+
+Diagnostics computeDiagnosticsCPU();
+std::string initDiagnosticsLogFile(const std::string &benchmarkLogFileName);
+void resetDiagnosticsBaseline();
+void logDiagnostics(const std::string &logFileName, const Diagnostics &diagnostics, std::size_t nbody, std::size_t step, const std::string &engine);
+
+
+#endif//N_BODY_SIMULATION_DIAGNOSTICS_HPP
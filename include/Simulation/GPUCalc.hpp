@@ -12,13 +12,28 @@
 #define __N_BODY_SIMULATION_GPUCALC_HPP__
 
 #include "../../lib/OpenCL/Device.hpp"
+#include "../PerformanceMetrics/Roofline.hpp"
+#include "Diagnostics.hpp"
+#include <ostream>
 #include <string>
 #include <vector>
 
-double simulateGPU();
+double simulateGPU(std::size_t steps = 1);
+cl_device_type parseDeviceType(const std::string &type);
+void listOpenClDevices(std::ostream &stream);
 void openClInit();
+bool isRenderedFromHost();
+bool isPublishedToRing();
+bool hasGLEventSharing();
+void publishPositionsGPU(unsigned slot);
 void gpuInit();
+void gpuRelease();
+void calibrateDeviceClock();
 void compileKernel(const std::vector<cl::Device> &devices);
+std::vector<float> readValidationSampleGPU();
+void downloadStateGPU();
+Diagnostics computeDiagnosticsGPU();
+PeakPerformance measureDevicePeak();
 
 
 #endif
@@ -0,0 +1,43 @@
+/**
+* @file Transfer.hpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a page-locked host staging buffer for transfers between host and OpenCL device
+* @version 1
+* @date 2022-02-07
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#ifndef N_BODY_SIMULATION_TRANSFER_HPP
+#define N_BODY_SIMULATION_TRANSFER_HPP
+
+#include "../../lib/OpenCL/cl-patched.hpp"
+#include <cstddef>
+
+/**
+ * @brief Host memory allocated by the OpenCL runtime with CL_MEM_ALLOC_HOST_PTR which stays mapped for its whole lifetime
+ *
+ * Most runtimes back such buffers with page-locked memory. Using the mapped pointer as source or destination of
+ * enqueueWriteBuffer/enqueueReadBuffer allows DMA transfers without the additional copy into an internal staging
+ * buffer which is necessary for pageable memory like a std::vector.
+ */
+class PinnedHostBuffer {
+private:
+    cl::Buffer buffer;
+    cl::CommandQueue mappingQueue;
+    float *hostPtr = nullptr;
+    std::size_t bytes = 0;
+
+public:
+    PinnedHostBuffer() = default;
+    PinnedHostBuffer(const PinnedHostBuffer &) = delete;
+    PinnedHostBuffer &operator=(const PinnedHostBuffer &) = delete;
+
+    void allocate(const cl::Context &context, const cl::CommandQueue &queue, std::size_t bytes);
+    void release();
+    float *data() const;
+    std::size_t size() const;
+};
+
+#endif//N_BODY_SIMULATION_TRANSFER_HPP
@@ -11,14 +11,16 @@
 #ifndef __CONSTANTS_HPP__
 #define __CONSTANTS_HPP__
 
-#define DEFAULT_OPENCL_DEVICE 1
-
 #define SCREEN_WIDTH 600
 #define SCREEN_HEIGHT 400
 #define WINDOW_TITLE "N-Body Simulation"
 
 #define VERTEX_SHADER_PATH "../shaders/vertex.shader"
 #define FRAGMENT_SHADER_PATH "../shaders/fragment.shader"
+#define CULL_SHADER_PATH "../shaders/cull.shader"
+#define TRAIL_SHADER_PATH "../shaders/trail.shader"
+
+#define LOD_CELL_SIZE 1 // Edge length in pixels of the screen cells in which bodies are merged into one point
 
 #define FOV 90.0f
 
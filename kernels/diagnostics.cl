@@ -0,0 +1,103 @@
+// Conservation diagnostics: every work item evaluates the quantities of one body,
+// each work group reduces them in local memory and writes one partial result per quantity.
+// The few partial results of all groups are summed up on the host.
+#if defined(cl_khr_fp64)
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double real;
+#else
+typedef float real;
+#endif
+
+#define NR_QUANTITIES 18// kinetic, potential, mass, momentum (3), angular momentum (3), mass * position (3), min (3), max (3)
+#define FIRST_MIN 12
+#define FIRST_MAX 15
+
+kernel void diagnosticsKernel(global float *positions,
+                              global float *velocities,
+                              global float *masses,
+                              int nrBodies,
+                              float G,
+                              float massScale,
+                              global real *partials,
+                              local real *scratch) {
+    const int id = get_global_id(0);
+    const int lid = get_local_id(0);
+    const int lSize = get_local_size(0);
+
+    real values[NR_QUANTITIES];
+    for (int q = 0; q < FIRST_MIN; q++) {
+        values[q] = 0;
+    }
+    for (int q = FIRST_MIN; q < FIRST_MAX; q++) {
+        values[q] = INFINITY;
+        values[q + 3] = -INFINITY;
+    }
+
+    if (id < nrBodies) {
+        real x = positions[id * 3];
+        real y = positions[id * 3 + 1];
+        real z = positions[id * 3 + 2];
+        real vx = velocities[id * 3];
+        real vy = velocities[id * 3 + 1];
+        real vz = velocities[id * 3 + 2];
+        // masses have been multiplied with G; the scale keeps the products in range for single precision
+        real m = masses[id] / G * massScale;
+
+        // sum of G * m_j / r_ij over all other bodies
+        // in double precision if possible, otherwise the drift would be hidden by the error of the sum itself
+        real potential = 0;
+        for (int j = 0; j < nrBodies; j++) {
+            if (j == id) {
+                continue;
+            }
+            real dis1 = x - positions[j * 3];
+            real dis2 = y - positions[j * 3 + 1];
+            real dis3 = z - positions[j * 3 + 2];
+            real distanceSquared = dis1 * dis1 + dis2 * dis2 + dis3 * dis3;
+#if defined(cl_khr_fp64)
+            potential += (real) masses[j] * massScale * rsqrt(distanceSquared);
+#else
+            potential += masses[j] * massScale * native_rsqrt(distanceSquared);
+#endif
+        }
+
+        values[0] = 0.5 * m * (vx * vx + vy * vy + vz * vz);
+        // every pair is visited twice
+        values[1] = 0.5 * m * potential;
+        values[2] = m;
+        values[3] = m * vx;
+        values[4] = m * vy;
+        values[5] = m * vz;
+        values[6] = m * (y * vz - z * vy);
+        values[7] = m * (z * vx - x * vz);
+        values[8] = m * (x * vy - y * vx);
+        values[9] = m * x;
+        values[10] = m * y;
+        values[11] = m * z;
+        values[12] = values[15] = x;
+        values[13] = values[16] = y;
+        values[14] = values[17] = z;
+    }
+
+    // tree reduction which also works for work group sizes that are no power of two
+    for (int q = 0; q < NR_QUANTITIES; q++) {
+        scratch[lid] = values[q];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int stride = 1; stride < lSize; stride *= 2) {
+            if (lid % (2 * stride) == 0 && lid + stride < lSize) {
+                if (q < FIRST_MIN) {
+                    scratch[lid] += scratch[lid + stride];
+                } else if (q < FIRST_MAX) {
+                    scratch[lid] = min(scratch[lid], scratch[lid + stride]);
+                } else {
+                    scratch[lid] = max(scratch[lid], scratch[lid + stride]);
+                }
+            }
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        if (lid == 0) {
+            partials[get_group_id(0) * NR_QUANTITIES + q] = scratch[0];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
@@ -0,0 +1,12 @@
+kernel void gatherKernel(global float *positions, global int *indices, global float *samplePositions, int sampleSize) {
+    // copies the positions of the sampled bodies into a compact buffer
+    // so that only a few bytes have to be read back for validation
+    int i = get_global_id(0);
+
+    if (i < sampleSize) {
+        int body = indices[i];
+        samplePositions[i * 3] = positions[body * 3];
+        samplePositions[i * 3 + 1] = positions[body * 3 + 1];
+        samplePositions[i * 3 + 2] = positions[body * 3 + 2];
+    }
+}
@@ -0,0 +1,31 @@
+// Microbenchmarks for the attained peak performance of the device.
+// peakFlopsKernel runs eight independent multiply-add chains per work item (16 flops per iteration),
+// peakCopyKernel streams a buffer with float4 loads and stores.
+kernel void peakFlopsKernel(global float *result, float a, float b, int iterations) {
+    float x0 = get_global_id(0);
+    float x1 = x0 + 1;
+    float x2 = x0 + 2;
+    float x3 = x0 + 3;
+    float x4 = x0 + 4;
+    float x5 = x0 + 5;
+    float x6 = x0 + 6;
+    float x7 = x0 + 7;
+
+    for (int i = 0; i < iterations; i++) {
+        x0 = mad(x0, a, b);
+        x1 = mad(x1, a, b);
+        x2 = mad(x2, a, b);
+        x3 = mad(x3, a, b);
+        x4 = mad(x4, a, b);
+        x5 = mad(x5, a, b);
+        x6 = mad(x6, a, b);
+        x7 = mad(x7, a, b);
+    }
+    // the result keeps the compiler from removing the loop
+    result[get_global_id(0)] = x0 + x1 + x2 + x3 + x4 + x5 + x6 + x7;
+}
+
+kernel void peakCopyKernel(global const float4 *source, global float4 *destination) {
+    int i = get_global_id(0);
+    destination[i] = source[i];
+}
@@ -0,0 +1,90 @@
+R"(
+#version 460 core
+
+// Culls bodies outside of the view and merges bodies whose centers fall into the same screen cell into the one with
+// the largest point. Pass 0 finds the largest point of every cell, pass 1 writes it into the compacted list of visible
+// bodies and counts it in the indirect draw command, so the draw call only processes one point per occupied cell.
+
+layout(local_size_x = 256) in;
+
+struct VisibleBody {
+    vec4 clipPosition;
+    vec4 colorSize; // rgb color and point size in pixels
+};
+
+layout(std430, binding = 0) readonly buffer Positions { float positions[]; };
+layout(std430, binding = 1) readonly buffer Masses { float masses[]; };
+layout(std430, binding = 2) writeonly buffer VisibleBodies { VisibleBody visibleBodies[]; };
+layout(std430, binding = 3) buffer DrawCommand { uint count; uint instanceCount; uint first; uint baseInstance; };
+layout(std430, binding = 4) buffer CellSizes { uint cellSizes[]; };  // largest point size of a cell (as float bits)
+layout(std430, binding = 5) buffer CellClaims { uint cellClaims[]; };// stamp of the frame in which a cell was emitted
+
+uniform mat4 M_mvp;
+
+uniform float maxPos;
+uniform float minMass;
+uniform float maxMass;
+uniform float zoomFactor;
+
+uniform uvec2 viewport;
+uniform uint cellSize;
+uniform uvec2 grid;
+uniform uint nrBodies;
+uniform uint cullPass;
+uniform uint stamp;
+
+const float MAX_ADD_RADIUS = 60.0f;
+const float BASE_RADIUS = 1.0f;
+const float EPSILON = 0.0001f;
+
+float log10(float x){
+    return log(x) / log(10);
+}
+
+// same size as the vertex shader and same hue as the fragment shader use for bodies
+void pointStyle(float mass, out float size, out vec3 color){
+    float logInMass = log10(mass);
+    float logMinMass = log10(minMass);
+    float logMaxMass = log10(maxMass);
+    size = float((logInMass - logMinMass) / (logMaxMass - logMinMass) * MAX_ADD_RADIUS) + BASE_RADIUS;
+    if((zoomFactor > 1 && logInMass >= 0.7 * logMaxMass) || zoomFactor < 1){
+        size *= zoomFactor;
+    }
+    float hue = 6 * (logInMass - logMinMass) / (logMaxMass + EPSILON - logMinMass);
+    color = clamp(abs(mod(hue + vec3(0, 4, 2), 6) - 3) - 1, 0, 1);
+}
+
+void main(){
+    uint i = gl_GlobalInvocationID.x;
+    if(i >= nrBodies){
+        return;
+    }
+    vec4 clipPosition = M_mvp * vec4(positions[3 * i], positions[3 * i + 2], positions[3 * i + 1], maxPos);
+    float size;
+    vec3 color;
+    pointStyle(masses[i], size, color);
+
+    // a point is visible if any part of it is on the screen
+    if(clipPosition.w <= 0 || abs(clipPosition.z) > clipPosition.w){
+        return;
+    }
+    vec2 ndc = clipPosition.xy / clipPosition.w;
+    vec2 radius = vec2(size) / vec2(viewport);
+    if(any(greaterThan(abs(ndc), vec2(1) + radius))){
+        return;
+    }
+    uvec2 pixel = uvec2(clamp((ndc * 0.5 + 0.5) * vec2(viewport), vec2(0), vec2(viewport - 1)));
+    uvec2 cellCoordinates = min(pixel / cellSize, grid - 1);
+    uint cell = cellCoordinates.y * grid.x + cellCoordinates.x;
+
+    // sizes are positive, so their bits have the same order as the floats
+    uint sizeBits = floatBitsToUint(size);
+    if(0 == cullPass){
+        atomicMax(cellSizes[cell], sizeBits);
+    }
+    else if(sizeBits == cellSizes[cell] && atomicExchange(cellClaims[cell], stamp) != stamp){
+        uint index = atomicAdd(count, 1);
+        visibleBodies[index] = VisibleBody(clipPosition, vec4(color, size));
+    }
+}
+)"
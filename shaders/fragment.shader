@@ -5,6 +5,8 @@ R"(
 #define EPSILON 0.0001 // Fixes the color when calculating it for the maximum mass object
                                             
 in vec3 lColor;
+flat in vec3 bodyColor;
+in float trailFade;
 
 in float logInMass;
 in float logMinMass;
@@ -13,7 +15,12 @@ in float logMaxMass;
 uniform float minMass;
 uniform float maxMass;
 
-uniform uint mode; //0 = Bodies, 1 = Lines
+uniform uint mode; //0 = Bodies, 1 = Lines, 2 = Bodies culled and styled by the cull shader, 3 = Density splats, 4 = Tone mapping, 5 = Trails
+
+uniform sampler2D densityTexture; // accumulated splats (rgb = weighted colors, a = weights)
+uniform int densityMeanLevel;     // mipmap level of densityTexture which contains only the mean of all pixels
+
+const float DENSITY_WHITE = 256.0f; // weight relative to the mean weight which is mapped to full brightness
 
 out vec4 fragColor;
 
@@ -84,5 +91,33 @@ void main(){
     else if (1 == mode){
         fragColor = vec4(lColor, 1.0f);
     }
+    // Splats are added up, so the color of a pixel is the weighted mean of the colors of its bodies
+    else if (3 == mode){
+        float degree = float(2 * M_PI * (logInMass - logMinMass) / (logMaxMass + EPSILON - logMinMass));
+        vec2 d = gl_PointCoord * 2 - 1;
+        float weight = exp(-4 * dot(d, d));
+        fragColor = vec4(hsv2rgb(degree, 1.0f, 1.0f) * weight, weight);
+    }
+    // Maps the logarithm of the accumulated weight to the brightness (relative to the mean, so no exposure has to be chosen)
+    else if (4 == mode){
+        vec4 density = texelFetch(densityTexture, ivec2(gl_FragCoord.xy), 0);
+        float mean = textureLod(densityTexture, vec2(0.5f), densityMeanLevel).a;
+        if (density.a <= 0 || mean <= 0){
+            fragColor = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        else{
+            float brightness = min(log(1 + density.a / mean) / log(1 + DENSITY_WHITE), 1.0f);
+            fragColor = vec4(density.rgb / density.a * brightness, 1.0f);
+        }
+    }
+    // Trails have the color of their body and fade out with the age of their positions
+    else if (5 == mode){
+        float degree = float(2 * M_PI * (logInMass - logMinMass) / (logMaxMass + EPSILON - logMinMass));
+        fragColor = vec4(hsv2rgb(degree, 1.0f, 1.0f), trailFade);
+    }
+    // The color has been calculated per body by the cull shader
+    else if (2 == mode){
+        fragColor = vec4(bodyColor, 1.0f);
+    }
 }
 )"
\ No newline at end of file
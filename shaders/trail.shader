@@ -0,0 +1,33 @@
+R"(
+#version 460 core
+
+// Appends the current position of every body to its trail. The trails are a ring of trailLength slots which hold the
+// positions of all bodies, so a frame writes one contiguous slot and nothing has to be shifted. On a reset all slots
+// are filled with the current position, so a new trail grows from a single point instead of the origin.
+
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) readonly buffer Positions { float positions[]; };
+layout(std430, binding = 6) writeonly buffer Trails { float trails[]; };
+
+uniform uint nrBodies;
+uniform uint trailLength;
+uniform uint trailHead;
+uniform uint trailReset;
+
+void main(){
+    uint i = gl_GlobalInvocationID.x;
+    if(i >= nrBodies){
+        return;
+    }
+    vec3 position = vec3(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]);
+    uint first = 0 != trailReset ? 0 : trailHead;
+    uint last = 0 != trailReset ? trailLength : trailHead + 1;
+    for(uint slot = first; slot < last; ++slot){
+        uint index = 3 * (slot * nrBodies + i);
+        trails[index] = position.x;
+        trails[index + 1] = position.y;
+        trails[index + 2] = position.z;
+    }
+}
+)"
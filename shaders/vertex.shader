@@ -5,6 +5,11 @@ layout(location=0) in vec3 inPosition;
 layout(location=1) in float inMass;
 layout(location=2) in vec3 lineCoordinates;
 layout(location=3) in vec3 lineColor;
+layout(location=4) in vec4 culledClipPosition;
+layout(location=5) in vec4 culledColorSize;
+
+layout(std430, binding = 1) readonly buffer Masses { float masses[]; };
+layout(std430, binding = 6) readonly buffer Trails { float trails[]; }; // ring of trailLength slots of all positions
 
 uniform mat4 M_model;
 uniform mat4 M_view;
@@ -14,14 +19,21 @@ uniform float maxPos;
 uniform float minMass;
 uniform float maxMass;
 
-uniform uint mode; //0 = Bodies, 1 = Lines
+uniform uint mode; //0 = Bodies, 1 = Lines, 2 = Bodies culled and styled by the cull shader, 3 = Density splats, 4 = Tone mapping, 5 = Trails
+
+uniform uint nrBodies;
+uniform uint trailLength;
+uniform uint trailHead; // slot of the newest trail positions
 
 uniform float zoomFactor = 1.0f;
 
 const float MAX_ADD_RADIUS = 60.0f;
 const float BASE_RADIUS = 1.0f;
+const float SPLAT_SIZE = 3.0f;
 
 out vec3 lColor;
+flat out vec3 bodyColor;
+out float trailFade;
 
 out float logInMass;
 out float logMinMass;
@@ -53,5 +65,37 @@ void main(){
         gl_Position = M_projection * M_view * M_model * vec4(lineCoordinates, 1.0f);
         lColor = lineColor;
     }
+    // Used for splatting the bodies into the density framebuffer; all splats have the same size
+    else if (3 == mode){
+        logInMass = log10(inMass);
+        logMinMass = log10(minMass);
+        logMaxMass = log10(maxMass);
+        gl_Position = M_projection * M_view * M_model * vec4(inPosition.x, inPosition.z, inPosition.y, maxPos);
+        gl_PointSize = SPLAT_SIZE;
+    }
+    // Used for the full screen triangle of the tone mapping pass
+    else if (4 == mode){
+        vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(corner * 2 - 1, 0, 1);
+    }
+    // Used for the trails; every pair of vertices is the segment between the positions of age a and a + 1 of a body
+    else if (5 == mode){
+        uint segments = trailLength - 1;
+        uint segment = uint(gl_VertexID) >> 1;
+        uint body = segment / segments;
+        uint age = segment % segments + (uint(gl_VertexID) & 1);
+        uint index = 3 * (((trailHead + trailLength - age) % trailLength) * nrBodies + body);
+        logInMass = log10(masses[body]);
+        logMinMass = log10(minMass);
+        logMaxMass = log10(maxMass);
+        gl_Position = M_projection * M_view * M_model * vec4(trails[index], trails[index + 2], trails[index + 1], maxPos);
+        trailFade = 1.0f - float(age) / float(segments);
+    }
+    // Used for rendering the visible bodies written by the cull shader
+    else if (2 == mode){
+        gl_Position = culledClipPosition;
+        gl_PointSize = culledColorSize.w;
+        bodyColor = culledColorSize.rgb;
+    }
 }
 )"
\ No newline at end of file
@@ -0,0 +1,583 @@
+/**
+ * @file bench.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Entry point of nbody_bench, which benchmarks the simulation engines without a window
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Data/WikipediaDataSet.hpp"
+#include "../../include/PerformanceMetrics/BenchmarkController.hpp"
+#include "../../include/PerformanceMetrics/PerformanceMetricsCollector.hpp"
+#include "../../include/PerformanceMetrics/Roofline.hpp"
+#include "../../include/PerformanceMetrics/Sweep.hpp"
+#include "../../include/PerformanceMetrics/PerfCounters.hpp"
+#include "../../include/PerformanceMetrics/Trace.hpp"
+#include "../../include/Simulation/CPUCalc.hpp"
+#include "../../include/Simulation/GPUCalc.hpp"
+#include "../../lib/OpenCL/Error.hpp"
+#include "../../lib/OpenCL/cl-patched.hpp"
+
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+extern bool useGPU;
+extern bool useCPU;
+extern AbstractData *dataSet;
+extern std::string kernelFile;
+extern std::string kernelInputPath;
+extern cl::Context context;
+extern int clPlatformIndex;
+extern int clDeviceIndex;
+extern cl_device_type clDeviceType;
+extern PerformanceMetricsCollector *performanceMetricsCollector;
+
+/**
+ * @brief Result of one engine and body count
+ */
+struct BenchResult {
+    std::string engine;         //!< Name of the engine (cpu, cpu-serial or the kernel file)
+    std::string precision;      //!< Floating point precision of the engine
+    int threads = 1;            //!< Number of OpenMP threads (only CPU engines)
+    std::size_t nbody = 0;      //!< Number of simulated bodies
+    std::size_t warmUpSteps = 0;//!< Steps needed until the step time was stable
+    PerformanceMetric steps;    //!< Time of the measured steps
+    PeakPerformance peak;       //!< Peak of the device the engine runs on
+    CounterValues counters;     //!< Hardware counters of the measured steps (CPU engines with --PerfCounters)
+};
+
+/**
+ * @brief One point of the thread-scaling study
+ */
+struct ScalingResult {
+    std::string engine;   //!< Name of the engine
+    std::string mode;     //!< "strong" (fixed N) or "weak" (fixed N per thread)
+    int threads = 1;      //!< Number of OpenMP threads
+    std::size_t nbody = 0;//!< Number of simulated bodies
+    double time = 0.0;    //!< Mean step time in seconds
+    double speedup = 1.0; //!< Speedup over one thread (scaled by the work per step in weak scaling)
+    double efficiency = 1.0;
+    double karpFlatt = 0.0;//!< Experimentally determined serial fraction (only strong scaling, not defined for one thread)
+};
+
+/**
+ * @brief Runs steps until the step time is stable.
+ *
+ * Uses the steady-state detection of BenchmarkController like the benchmark mode of the simulation, so both decide
+ * the end of the warm-up the same way and report the same number of warm-up steps for the same engine.
+ *
+ * @param step function calculating one step and returning its duration in seconds
+ * @param maxSteps upper bound for the number of warm-up steps
+ * @return std::size_t number of warm-up steps
+ */
+static std::size_t warmUp(const std::function<double()> &step, std::size_t maxSteps) {
+    // defaults of --BenchmarkCI and --BenchmarkBudget; only the warm-up phase of the controller is used
+    BenchmarkController controller(0.02, 60.0);
+    while (controller.getWarmUpSteps() < maxSteps && controller.addSample(step()) == BenchmarkController::State::WARM_UP) {
+    }
+    return controller.getWarmUpSteps();
+}
+
+/**
+ * @brief Escapes a string for JSON.
+ *
+ * @param text the string
+ * @return std::string quoted string
+ */
+static std::string jsonString(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20)
+            quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/**
+ * @brief Writes all results as JSON.
+ *
+ * @param out output stream
+ * @param results results of all engines and body counts
+ * @param scaling results of the thread-scaling study (empty if it was not run)
+ * @param openClDevice name of the OpenCL device or an empty string if no kernels were run
+ */
+static void writeJson(std::ostream &out, const std::vector<BenchResult> &results, const std::vector<ScalingResult> &scaling,
+                      const std::string &openClDevice) {
+    out << "{\n";
+    out << "  \"timestamp\": " << jsonString(PerformanceMetricsCollector::getTimeStamp()) << ",\n";
+#ifdef ENABLE_SIMD
+    out << "  \"simd\": true,\n";
+#else
+    out << "  \"simd\": false,\n";
+#endif
+    out << "  \"opencl_device\": " << jsonString(openClDevice) << ",\n";
+    out << "  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        double interactions = getInteractionsPerStep(r.nbody) / r.steps.getAvgTime();
+        double gflops = interactions * flopsPerInteraction * 1e-9;
+        double bandwidth = getBytesPerStep(r.nbody) / r.steps.getAvgTime() * 1e-9;
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"engine\": " << jsonString(r.engine) << ", \"precision\": " << jsonString(r.precision)
+            << ", \"threads\": " << r.threads << ", \"nbody\": " << r.nbody << ", \"warmup_steps\": " << r.warmUpSteps
+            << ", \"repetitions\": " << r.steps.getCount() << ",\n";
+        out << "     \"min\": " << r.steps.getMinTime() << ", \"p50\": " << r.steps.getPercentile(50)
+            << ", \"mean\": " << r.steps.getAvgTime() << ", \"p90\": " << r.steps.getPercentile(90)
+            << ", \"p99\": " << r.steps.getPercentile(99) << ", \"max\": " << r.steps.getMaxTime()
+            << ", \"stddev\": " << r.steps.getStdDev() << ", \"cv\": " << r.steps.getCoefficientOfVariation() << ",\n";
+        out << "     \"interactions_per_s\": " << interactions << ", \"gflops\": " << gflops << ", \"bandwidth_gbs\": " << bandwidth
+            << ", \"peak_gflops\": " << r.peak.gflops << ", \"peak_bandwidth_gbs\": " << r.peak.bandwidth
+            << ", \"peak_source\": " << jsonString(r.peak.source);
+        if (r.counters.regions > 0) {
+            out << ",\n     \"counters\": {\"threads\": " << r.counters.threads;
+            if (r.counters.isValid(Counter::CYCLES) && r.counters.isValid(Counter::INSTRUCTIONS))
+                out << ", \"ipc\": " << r.counters.getIpc();
+            if (r.counters.isValid(Counter::CACHE_MISSES))
+                out << ", \"cache_misses_per_interaction\": " << r.counters.getPerInteraction(Counter::CACHE_MISSES, r.nbody);
+            if (r.counters.isValid(Counter::BRANCH_MISSES))
+                out << ", \"branch_misses_per_interaction\": " << r.counters.getPerInteraction(Counter::BRANCH_MISSES, r.nbody);
+            if (r.counters.isValid(Counter::FP_OPS))
+                out << ", \"fp_ops_per_interaction\": " << r.counters.getPerInteraction(Counter::FP_OPS, r.nbody);
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]";
+    if (!scaling.empty()) {
+        out << ",\n  \"scaling\": [";
+        for (std::size_t i = 0; i < scaling.size(); ++i) {
+            const ScalingResult &r = scaling[i];
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    {\"engine\": " << jsonString(r.engine) << ", \"mode\": " << jsonString(r.mode) << ", \"threads\": " << r.threads
+                << ", \"nbody\": " << r.nbody << ", \"mean\": " << r.time << ", \"speedup\": " << r.speedup
+                << ", \"efficiency\": " << r.efficiency << ", \"karp_flatt\": ";
+            if (r.mode == "strong" && r.threads > 1)
+                out << r.karpFlatt;
+            else
+                out << "null";
+            out << "}";
+        }
+        out << "\n  ]";
+    }
+    out << "\n}\n";
+}
+
+/**
+ * @brief Measures an engine with the given number of bodies; useCPU/useGPU and the kernel must already be set up.
+ *
+ * @param name name of the engine
+ * @param n number of bodies
+ * @param threads number of OpenMP threads the engine runs with
+ * @param peak peak of the device the engine runs on
+ * @param distribution random distribution of the initial positions
+ * @param seed seed of the random bodies
+ * @param repetitions number of measured steps
+ * @param maxWarmUp upper bound for the number of warm-up steps
+ * @return BenchResult measured step times
+ */
+static BenchResult measure(const std::string &name, std::size_t n, int threads, const PeakPerformance &peak,
+                           const std::string &distribution, uint64_t seed, int repetitions, int maxWarmUp) {
+    dataSet = new WikipediaDataSet(n, distribution, seed);
+    performanceMetricsCollector = new PerformanceMetricsCollector();
+    if (useGPU)
+        gpuInit();
+    std::function<double()> step = useCPU ? std::function<double()>([] { return simulateCPU(1); })
+                                          : std::function<double()>([] { return simulateGPU(1); });
+
+    BenchResult result;
+    result.engine = name;
+    result.precision = "fp32";
+    result.threads = threads;
+    result.nbody = dataSet->getSize();
+    result.peak = peak;
+    result.warmUpSteps = warmUp(step, maxWarmUp);
+    // the counters of the warm-up steps are discarded
+    delete performanceMetricsCollector;
+    performanceMetricsCollector = new PerformanceMetricsCollector();
+    for (int r = 0; r < repetitions; ++r)
+        result.steps.addTime(step());
+    result.counters = performanceMetricsCollector->getCounters();
+    std::cerr << name << " N=" << result.nbody << " threads=" << threads << ": " << result.steps.getPercentile(50)
+              << "s per step (p50) after " << result.warmUpSteps << " warm-up steps" << std::endl;
+
+    delete performanceMetricsCollector;
+    delete dataSet;
+    return result;
+}
+
+/**
+ * @brief Returns the CPUs the process may run on.
+ *
+ * @return std::vector<int> CPU numbers (empty if affinity is not supported)
+ */
+static std::vector<int> getAllowedCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+/**
+ * @brief Pins the threads of the following parallel regions to CPUs (like OMP_PLACES=threads).
+ *
+ * "close" puts thread i on the i-th allowed CPU, "spread" distributes the threads evenly over all allowed CPUs and
+ * "none" allows every thread to run on all of them again. OMP_PROC_BIND can't be changed once the OpenMP runtime is
+ * running, so the threads are pinned with sched_setaffinity; this relies on the runtime reusing its threads with
+ * the same thread numbers for teams of the same size (which libgomp and the LLVM runtime do).
+ *
+ * @param binding "none", "close" or "spread"
+ * @param threads size of the team
+ * @param cpus allowed CPUs
+ */
+static void bindThreads(const std::string &binding, int threads, const std::vector<int> &cpus) {
+#if defined(__linux__) && defined(_OPENMP)
+    if (cpus.empty())
+        return;
+#pragma omp parallel num_threads(threads) default(none) shared(binding, threads, cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        std::size_t thread = static_cast<std::size_t>(omp_get_thread_num());
+        if (binding == "close") {
+            CPU_SET(cpus[thread % cpus.size()], &set);
+        } else if (binding == "spread") {
+            CPU_SET(cpus[thread * cpus.size() / static_cast<std::size_t>(threads) % cpus.size()], &set);
+        } else {
+            for (int cpu : cpus)
+                CPU_SET(cpu, &set);
+        }
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#endif
+}
+
+/**
+ * @brief Measures the CPU engines with 1, 2, 4, ... and the maximum number of threads.
+ *
+ * Strong scaling keeps N fixed; weak scaling keeps N per thread fixed, so the work of a step grows with the
+ * square of the thread count and the speedup is scaled by the work. For strong scaling the Karp-Flatt metric
+ * e = (1/S - 1/p) / (1 - 1/p) estimates the serial fraction; if it grows with p, the loss comes from
+ * parallel overhead rather than from serial code. It assumes a fixed problem size, so it is not reported for weak
+ * scaling. The peak of the host is measured with the same number of threads and binding as every point.
+ *
+ * @param engines CPU engines to study
+ * @param baseBodies N for strong scaling and N per thread for weak scaling
+ * @param binding thread binding ("none", "close" or "spread")
+ * @param distribution random distribution of the initial positions
+ * @param seed seed of the random bodies
+ * @param repetitions number of measured steps
+ * @param maxWarmUp upper bound for the number of warm-up steps
+ * @param maxStepTime larger thread counts are skipped in weak scaling once a step takes longer (seconds)
+ * @param results receives the raw measurements
+ * @return std::vector<ScalingResult> speedup, efficiency and Karp-Flatt metric of every point
+ */
+static std::vector<ScalingResult> runScalingStudy(const std::vector<std::string> &engines, std::size_t baseBodies, const std::string &binding,
+                                                  const std::string &distribution, uint64_t seed, int repetitions, int maxWarmUp,
+                                                  double maxStepTime, std::vector<BenchResult> &results) {
+    std::vector<ScalingResult> scaling;
+#ifdef _OPENMP
+    int maxThreads = omp_get_max_threads();
+    std::vector<int> threadCounts;
+    for (int p = 1; p < maxThreads; p *= 2)
+        threadCounts.push_back(p);
+    threadCounts.push_back(maxThreads);
+    std::vector<int> cpus = getAllowedCpus();
+    std::vector<PeakPerformance> peaks;
+    for (int p : threadCounts) {
+        omp_set_num_threads(p);
+        bindThreads(binding, p, cpus);
+        peaks.push_back(measureHostPeak());
+    }
+
+    useCPU = true;
+    useGPU = false;
+    for (const std::string &name : engines) {
+        for (const std::string mode : {"strong", "weak"}) {
+            double baseThroughput = 0.0;
+            for (std::size_t t = 0; t < threadCounts.size(); ++t) {
+                int p = threadCounts[t];
+                omp_set_num_threads(p);
+                bindThreads(binding, p, cpus);
+                std::size_t n = mode == "strong" ? baseBodies : baseBodies * static_cast<std::size_t>(p);
+                BenchResult result = measure(name, n, p, peaks[t], distribution, seed, repetitions, maxWarmUp);
+                results.push_back(result);
+
+                ScalingResult point;
+                point.engine = name;
+                point.mode = mode;
+                point.threads = p;
+                point.nbody = result.nbody;
+                point.time = result.steps.getAvgTime();
+                // throughput in interactions per second makes strong and weak scaling comparable
+                double throughput = getInteractionsPerStep(result.nbody) / point.time;
+                if (p == 1)
+                    baseThroughput = throughput;
+                point.speedup = throughput / baseThroughput;
+                point.efficiency = point.speedup / p;
+                bool karpFlatt = mode == "strong" && p > 1;
+                if (karpFlatt)
+                    point.karpFlatt = (1.0 / point.speedup - 1.0 / p) / (1.0 - 1.0 / p);
+                scaling.push_back(point);
+                std::cerr << "  " << mode << " scaling: speedup " << point.speedup << ", efficiency " << point.efficiency;
+                if (karpFlatt)
+                    std::cerr << ", Karp-Flatt " << point.karpFlatt;
+                std::cerr << std::endl;
+
+                if (result.steps.getMaxTime() > maxStepTime)
+                    break;
+            }
+        }
+    }
+    omp_set_num_threads(maxThreads);
+    bindThreads("none", maxThreads, cpus);
+#endif
+    return scaling;
+}
+
+/**
+ * @brief Entry point of nbody_bench
+ *
+ * Every engine is run for every body count of the sweep in a single process. The OpenCL context is created
+ * once and the kernels are only recompiled when the kernel file changes.
+ *
+ * @param argc Command-line argument count
+ * @param argv Command-line arguments
+ * @return int Status Code
+ */
+int main(int argc, char *argv[]) {
+    kernelInputPath = "../kernels/";
+    std::string engineList = "cpu,cpu-serial,nbody.cl,nbody_local.cl,nbody_async.cl";
+    std::string sweep = "1024:16384:x2";
+    std::string bodyInitDistribution = "normal";
+    std::string outputFile;
+    int repetitions = 10;
+    int maxWarmUp = 50;
+    double maxStepTime = 5.0;
+    std::size_t scalingBodies = 0;
+    std::string binding = "none";
+
+    boost::program_options::options_description optionDescription("Command Line Options");
+    optionDescription.add_options()("Engines", boost::program_options::value<std::string>(), "Comma separated engines: cpu, cpu-serial and/or OpenCL kernel files (defaults to all)");
+    optionDescription.add_options()("Sweep", boost::program_options::value<std::string>(), "Body counts as first:last:xF, first:last:+S or a comma separated list (defaults to 1024:16384:x2)");
+    optionDescription.add_options()("Repeat", boost::program_options::value<int>(), "Number of measured steps per engine and body count (defaults to 10)");
+    optionDescription.add_options()("MaxWarmUp", boost::program_options::value<int>(), "Maximum number of warm-up steps (defaults to 50)");
+    optionDescription.add_options()("MaxStepTime", boost::program_options::value<double>(), "Larger body counts are skipped for an engine once a step takes longer (seconds, defaults to 5)");
+    optionDescription.add_options()("Random_Initialization", boost::program_options::value<std::string>(), "Random distribution used for initializing body positions; MUST BE 'uniform' or 'normal'");
+    optionDescription.add_options()("Seed", boost::program_options::value<uint64_t>(), "Seed of the random bodies (defaults to 0, so that all runs simulate the same bodies)");
+    optionDescription.add_options()("ListDevices", "List all OpenCL platforms and devices and exit");
+    optionDescription.add_options()("Platform", boost::program_options::value<int>(), "Index of the OpenCL platform (see --ListDevices; defaults to searching all platforms)");
+    optionDescription.add_options()("DeviceType", boost::program_options::value<std::string>(), "Type of the OpenCL device: cpu, gpu, accelerator or all (defaults to a GPU if there is one)");
+    optionDescription.add_options()("DeviceIndex", boost::program_options::value<int>(), "Index of the OpenCL device on the selected platform (the first one if --Platform is not given) as printed by --ListDevices; without it the first device of the requested type is used");
+    optionDescription.add_options()("CL_Kernel_Path", boost::program_options::value<std::string>(), "Path to OpenCL Kernel files");
+    optionDescription.add_options()("Trace", boost::program_options::value<std::string>()->implicit_value("trace.json"), "Record a timeline of all phases and write it in the Chrome trace-event format (defaults to trace.json)");
+    optionDescription.add_options()("PerfCounters", "Count cycles, instructions, cache misses, branch misses and FP operations of the CPU force calculation (Linux only)");
+    optionDescription.add_options()("ScalingStudy", boost::program_options::value<std::size_t>(), "Instead of the sweep, measure the CPU engines with 1, 2, 4, ... max threads for N bodies (strong scaling) and N bodies per thread (weak scaling)");
+    optionDescription.add_options()("Bind", boost::program_options::value<std::string>(), "Thread binding in the scaling study: none, close or spread (defaults to none)");
+    optionDescription.add_options()("Output", boost::program_options::value<std::string>(), "JSON file the results are written to (defaults to stdout)");
+    boost::program_options::variables_map vm;
+
+    try {
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, optionDescription), vm);
+        boost::program_options::notify(vm);
+    } catch (...) {
+        std::cerr << "Please make sure that you only use well-formed command line arguments!\n";
+        return 1;
+    }
+
+    if (vm.count("Engines"))
+        engineList = vm["Engines"].as<std::string>();
+    if (vm.count("Sweep"))
+        sweep = vm["Sweep"].as<std::string>();
+    if (vm.count("Repeat"))
+        repetitions = vm["Repeat"].as<int>();
+    if (vm.count("MaxWarmUp"))
+        maxWarmUp = vm["MaxWarmUp"].as<int>();
+    if (vm.count("MaxStepTime"))
+        maxStepTime = vm["MaxStepTime"].as<double>();
+    if (vm.count("ListDevices")) {
+        listOpenClDevices(std::cout);
+        return 0;
+    }
+    if (vm.count("Platform")) {
+        clPlatformIndex = vm["Platform"].as<int>();
+        if (clPlatformIndex < 0) {
+            std::cerr << "Platform must not be negative.\n";
+            return 1;
+        }
+    }
+    if (vm.count("DeviceIndex")) {
+        clDeviceIndex = vm["DeviceIndex"].as<int>();
+        if (clDeviceIndex < 0) {
+            std::cerr << "DeviceIndex must not be negative.\n";
+            return 1;
+        }
+    }
+    if (vm.count("DeviceType")) {
+        try {
+            clDeviceType = parseDeviceType(vm["DeviceType"].as<std::string>());
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+    if (vm.count("CL_Kernel_Path"))
+        kernelInputPath = vm["CL_Kernel_Path"].as<std::string>();
+    if (vm.count("Output"))
+        outputFile = vm["Output"].as<std::string>();
+    if (vm.count("ScalingStudy")) {
+        scalingBodies = vm["ScalingStudy"].as<std::size_t>();
+#ifndef _OPENMP
+        std::cerr << "The scaling study needs a build with OpenMP.\n";
+        return 1;
+#endif
+    }
+    if (vm.count("Bind")) {
+        binding = vm["Bind"].as<std::string>();
+        if (binding != "none" && binding != "close" && binding != "spread") {
+            std::cerr << "Invalid thread binding given; must be 'none', 'close' or 'spread'\n";
+            return 1;
+        }
+    }
+    std::string traceFileName;
+    if (vm.count("Trace")) {
+        traceFileName = vm["Trace"].as<std::string>();
+        Trace::enable();
+    }
+    if (vm.count("PerfCounters"))
+        PerfCounters::enable();
+    if (vm.count("Random_Initialization")) {
+        bodyInitDistribution = vm["Random_Initialization"].as<std::string>();
+        if (bodyInitDistribution != "normal" && bodyInitDistribution != "uniform") {
+            std::cerr << "Invalid initialization distribution given; must be 'uniform' or 'normal'\n";
+            return 1;
+        }
+    }
+    uint64_t seed = 0;
+    if (vm.count("Seed")) {
+        seed = vm["Seed"].as<uint64_t>();
+    }
+    if (repetitions <= 0 || maxWarmUp < 0 || maxStepTime <= 0.0) {
+        std::cerr << "Repeat and MaxStepTime must be positive and MaxWarmUp must not be negative.\n";
+        return 1;
+    }
+
+    std::vector<std::size_t> bodyCounts;
+    try {
+        bodyCounts = parseSweep(sweep);
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> engines;
+    std::stringstream engineStream(engineList);
+    std::string engine;
+    while (std::getline(engineStream, engine, ','))
+        engines.push_back(engine);
+    if (scalingBodies > 0) {
+        // only the multithreaded CPU engines are studied
+        engines.erase(std::remove_if(engines.begin(), engines.end(), [](const std::string &e) { return e.rfind("cpu", 0) != 0 || e == "cpu-serial"; }),
+                      engines.end());
+        if (engines.empty()) {
+            std::cerr << "The scaling study needs the engine cpu in --Engines.\n";
+            return 1;
+        }
+    }
+
+    // the OpenCL context is only created if a kernel is benchmarked and skipped if there is no platform
+    auto firstKernel = std::find_if(engines.begin(), engines.end(), [](const std::string &e) { return e.rfind("cpu", 0) != 0; });
+    bool openCl = firstKernel != engines.end();
+    std::string openClDevice;
+    PeakPerformance hostPeak;
+    PeakPerformance devicePeak;
+    if (openCl) {
+        cl_uint platforms = 0;
+        try {
+            if (clGetPlatformIDs(0, NULL, &platforms) != CL_SUCCESS || platforms == 0)
+                throw OpenCL::Error(CL_DEVICE_NOT_FOUND, "no OpenCL platform");
+            kernelFile = *firstKernel;
+            openClInit();
+            devicePeak = measureDevicePeak();
+            openClDevice = devicePeak.source;
+        } catch (OpenCL::Error &e) {
+            std::cerr << "OpenCL is not available, kernels are skipped: " << e.what() << std::endl;
+            openCl = false;
+        }
+    }
+    // the scaling study measures the host peak for every thread count itself
+    if (scalingBodies == 0 && std::any_of(engines.begin(), engines.end(), [](const std::string &e) { return e.rfind("cpu", 0) == 0; }))
+        hostPeak = measureHostPeak();
+
+    int maxThreads = 1;
+#ifdef _OPENMP
+    maxThreads = omp_get_max_threads();
+#endif
+
+    std::vector<BenchResult> results;
+    std::vector<ScalingResult> scaling;
+    if (scalingBodies > 0) {
+        scaling = runScalingStudy(engines, scalingBodies, binding, bodyInitDistribution, seed, repetitions, maxWarmUp, maxStepTime, results);
+        engines.clear();
+    }
+    for (const std::string &name : engines) {
+        bool cpu = name == "cpu" || name == "cpu-serial";
+        if (!cpu && !openCl)
+            continue;
+#ifndef _OPENMP
+        if (name == "cpu-serial")
+            continue;// without OpenMP "cpu" already runs on one thread
+#endif
+        useCPU = cpu;
+        useGPU = !cpu;
+        int threads = name == "cpu-serial" ? 1 : maxThreads;
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        if (!cpu && kernelFile != name) {
+            kernelFile = name;
+            compileKernel(std::vector<cl::Device>{context.getInfo<CL_CONTEXT_DEVICES>()[0]});
+        }
+
+        for (std::size_t n : bodyCounts) {
+            BenchResult result = measure(name, n, cpu ? threads : 1, cpu ? hostPeak : devicePeak, bodyInitDistribution, seed, repetitions, maxWarmUp);
+            results.push_back(result);
+            // the step time grows quadratically, so larger body counts would take even longer
+            if (result.steps.getMaxTime() > maxStepTime)
+                break;
+        }
+    }
+
+    if (outputFile.empty()) {
+        writeJson(std::cout, results, scaling, openClDevice);
+    } else {
+        std::ofstream out(outputFile);
+        writeJson(out, results, scaling, openClDevice);
+    }
+    Trace::writeTraceFile(traceFileName);
+    return 0;
+}
@@ -34,14 +34,66 @@ double AbstractData::getMinMass() const {
     return this->mMin;
 }
 
-std::vector<float3> AbstractData::getPositions() {
+const std::vector<float3> &AbstractData::getPositions() const {
     return this->positions;
 }
 
-std::vector<float3> AbstractData::getVelocities() {
+const std::vector<float3> &AbstractData::getVelocities() const {
     return this->velocities;
 }
 
 std::size_t AbstractData::getBytesCount() const {
     return this->size * 3 * sizeof(float);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Flattens the positions into an external buffer without any intermediate copy
+ *
+ * @param destination Buffer which can hold 3 * getSize() floats
+ */
+void AbstractData::writeFlatPositions(float *destination) const {
+#pragma omp parallel for default(none) shared(destination)
+    for (std::size_t i = 0; i < this->size; ++i) {
+        destination[3 * i] = this->positions[i].x;
+        destination[3 * i + 1] = this->positions[i].y;
+        destination[3 * i + 2] = this->positions[i].z;
+    }
+}
+
+/**
+ * @brief Replaces the positions with positions in the flat layout (stride 3)
+ *
+ * @param source Buffer which holds 3 * getSize() floats
+ */
+void AbstractData::readFlatPositions(const float *source) {
+#pragma omp parallel for default(none) shared(source)
+    for (std::size_t i = 0; i < this->size; ++i) {
+        this->positions[i] = float3(source[3 * i], source[3 * i + 1], source[3 * i + 2]);
+    }
+}
+
+/**
+ * @brief Replaces the velocities with velocities in the flat layout (stride 3)
+ *
+ * @param source Buffer which holds 3 * getSize() floats
+ */
+void AbstractData::readFlatVelocities(const float *source) {
+#pragma omp parallel for default(none) shared(source)
+    for (std::size_t i = 0; i < this->size; ++i) {
+        this->velocities[i] = float3(source[3 * i], source[3 * i + 1], source[3 * i + 2]);
+    }
+}
+
+/**
+ * @brief Flattens the velocities into an external buffer without any intermediate copy
+ *
+ * @param destination Buffer which can hold 3 * getSize() floats
+ */
+void AbstractData::writeFlatVelocities(float *destination) const {
+#pragma omp parallel for default(none) shared(destination)
+    for (std::size_t i = 0; i < this->size; ++i) {
+        destination[3 * i] = this->velocities[i].x;
+        destination[3 * i + 1] = this->velocities[i].y;
+        destination[3 * i + 2] = this->velocities[i].z;
+    }
+}
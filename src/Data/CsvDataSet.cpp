@@ -0,0 +1,292 @@
+/**
+ * @file CsvDataSet.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the importer of initial conditions from CSV files
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Data/CsvDataSet.hpp"
+#include "../../include/Data/Snapshot.hpp"
+#include "../../include/Data/SnapshotDataSet.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const int csvColumns = 7;//!< x, y, z, vx, vy, vz, m
+
+/**
+ * @brief Returns the end of the line starting at position (the position of '\n' or end)
+ */
+static const char *lineEnd(const char *position, const char *end) {
+    const char *newline = static_cast<const char *>(std::memchr(position, '\n', end - position));
+    return newline != nullptr ? newline : end;
+}
+
+static const char *skipBlanks(const char *position, const char *end) {
+    while (position < end && (*position == ' ' || *position == '\t' || *position == '\r'))
+        ++position;
+    return position;
+}
+
+/**
+ * @brief Whether a line contains no body (empty or a comment)
+ */
+static bool isSkipped(const char *line, const char *end) {
+    line = skipBlanks(line, end);
+    return line == end || *line == '#';
+}
+
+/**
+ * @brief Parses a decimal floating point number without locale and without copying the text
+ *
+ * @param position start of the number, advanced behind it
+ * @param end end of the line
+ * @param value receives the number
+ * @return false if there is no number at position
+ */
+static bool parseNumber(const char *&position, const char *end, float &value) {
+    const char *p = skipBlanks(position, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    int significantDigits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+        // more digits than fit into the mantissa only change the magnitude
+        if (significantDigits < 19) {
+            mantissa = 10 * mantissa + (*p - '0');
+            significantDigits += mantissa > 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            if (significantDigits < 19) {
+                mantissa = 10 * mantissa + (*p - '0');
+                significantDigits += mantissa > 0;
+                --exponent;
+            }
+        }
+    }
+    if (digits == 0)
+        return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExponent = *q++ == '-';
+        if (q == end || *q < '0' || *q > '9')
+            return false;
+        int explicitExponent = 0;
+        for (; q < end && *q >= '0' && *q <= '9'; ++q)
+            explicitExponent = std::min(10 * explicitExponent + (*q - '0'), 100000);
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        p = q;
+    }
+    double result = static_cast<double>(mantissa);
+    if (exponent < 0)
+        result /= std::pow(10.0, -exponent);
+    else if (exponent > 0)
+        result *= std::pow(10.0, exponent);
+    value = static_cast<float>(negative ? -result : result);
+    position = p;
+    return true;
+}
+
+/**
+ * @brief Parses the columns of a line
+ *
+ * @return false if the line doesn't consist of csvColumns comma separated numbers
+ */
+static bool parseLine(const char *line, const char *end, float values[csvColumns]) {
+    for (int column = 0; column < csvColumns; ++column) {
+        if (!parseNumber(line, end, values[column]))
+            return false;
+        line = skipBlanks(line, end);
+        if (column + 1 < csvColumns) {
+            if (line == end || *line != ',')
+                return false;
+            ++line;
+        }
+    }
+    return line == end;
+}
+
+/**
+ * @brief Maps and parses a CSV file.
+ *
+ * @param fileName path of the CSV file
+ */
+CsvDataSet::CsvDataSet(const std::string &fileName) {
+    this->name = "CSV " + fileName;
+    boost::interprocess::mapped_region region;
+    try {
+        boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_only);
+        region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only);
+    } catch (const boost::interprocess::interprocess_exception &e) {
+        throw std::runtime_error("Can't open " + fileName + ": " + e.what());
+    }
+    region.advise(boost::interprocess::mapped_region::advice_sequential);
+    const char *begin = static_cast<const char *>(region.get_address());
+    const char *end = begin + region.get_size();
+
+    // skip leading comments and a header line, which is the first line not starting with a number
+    std::size_t firstLine = 1;
+    const char *dataBegin = begin;
+    while (dataBegin < end && isSkipped(dataBegin, lineEnd(dataBegin, end))) {
+        dataBegin = std::min(lineEnd(dataBegin, end) + 1, end);
+        ++firstLine;
+    }
+    const char *first = skipBlanks(dataBegin, end);
+    if (first < end && !(*first >= '0' && *first <= '9') && *first != '-' && *first != '+' && *first != '.') {
+        dataBegin = std::min(lineEnd(dataBegin, end) + 1, end);
+        ++firstLine;
+    }
+
+    // blocks start behind the first newline after an equal share of the bytes
+    int blockCount = 1;
+#ifdef _OPENMP
+    blockCount = omp_get_max_threads();
+#endif
+    std::vector<const char *> blockBegins(blockCount + 1);
+    blockBegins[0] = dataBegin;
+    blockBegins[blockCount] = end;
+    for (int block = 1; block < blockCount; ++block) {
+        const char *split = dataBegin + (end - dataBegin) * block / blockCount;
+        split = split > dataBegin && split[-1] != '\n' ? std::min(lineEnd(split, end) + 1, end) : split;
+        blockBegins[block] = std::max(split, blockBegins[block - 1]);
+    }
+
+    std::vector<std::size_t> bodies(blockCount + 1, 0);
+    std::vector<std::size_t> lines(blockCount + 1, 0);
+#pragma omp parallel for default(none) shared(blockCount, blockBegins, bodies, lines, end)
+    for (int block = 0; block < blockCount; ++block) {
+        for (const char *line = blockBegins[block]; line < blockBegins[block + 1];) {
+            const char *next = lineEnd(line, end);
+            ++lines[block + 1];
+            bodies[block + 1] += !isSkipped(line, next);
+            line = next + 1;
+        }
+    }
+    for (int block = 0; block < blockCount; ++block) {
+        bodies[block + 1] += bodies[block];
+        lines[block + 1] += lines[block];
+    }
+
+    this->size = bodies[blockCount];
+    this->positions.resize(this->size);
+    this->velocities.resize(this->size);
+    this->masses.resize(this->size);
+    std::vector<std::size_t> errorLines(blockCount, 0);
+#pragma omp parallel for default(none) shared(blockCount, blockBegins, bodies, lines, errorLines, end, firstLine)
+    for (int block = 0; block < blockCount; ++block) {
+        std::size_t body = bodies[block];
+        std::size_t lineNumber = firstLine + lines[block];
+        float values[csvColumns];
+        for (const char *line = blockBegins[block]; line < blockBegins[block + 1]; ++lineNumber) {
+            const char *next = lineEnd(line, end);
+            if (!isSkipped(line, next)) {
+                if (!parseLine(line, next, values)) {
+                    errorLines[block] = lineNumber;
+                    break;
+                }
+                this->positions[body] = float3(values[0], values[1], values[2]);
+                this->velocities[body] = float3(values[3], values[4], values[5]);
+                this->masses[body] = values[6];
+                ++body;
+            }
+            line = next + 1;
+        }
+    }
+    for (std::size_t errorLine : errorLines) {
+        if (errorLine != 0)
+            throw std::runtime_error(fileName + ":" + std::to_string(errorLine) + ": expected " + std::to_string(csvColumns) + " comma separated numbers (x, y, z, vx, vy, vz, m)");
+    }
+    if (this->size == 0)
+        throw std::runtime_error(fileName + " contains no bodies");
+
+    // the ranges are used by the shader
+    double pMax = 0, vMax = 0, mMax = 0, mMin = HUGE_VAL;
+    const std::size_t n = this->size;
+#pragma omp parallel for default(none) shared(n) reduction(max : pMax, vMax, mMax) reduction(min : mMin)
+    for (std::size_t i = 0; i < n; ++i) {
+        const float3 &p = this->positions[i];
+        const float3 &v = this->velocities[i];
+        pMax = std::max(pMax, static_cast<double>(std::max({std::fabs(p.x), std::fabs(p.y), std::fabs(p.z)})));
+        vMax = std::max(vMax, static_cast<double>(std::max({std::fabs(v.x), std::fabs(v.y), std::fabs(v.z)})));
+        mMax = std::max(mMax, static_cast<double>(this->masses[i]));
+        mMin = std::min(mMin, static_cast<double>(this->masses[i]));
+    }
+    this->pMax = pMax;
+    this->pMin = 0;
+    this->vMax = vMax;
+    this->vMin = 0;
+    this->mMax = mMax;
+    this->mMin = mMin;
+
+    this->flatPositions.resize(3 * this->size);
+    this->flatVelocities.resize(3 * this->size);
+}
+
+std::vector<float> CsvDataSet::getFlatPositions() {
+    this->writeFlatPositions(this->flatPositions.data());
+    return this->flatPositions;
+}
+
+std::vector<float> CsvDataSet::getFlatVelocities() {
+    this->writeFlatVelocities(this->flatVelocities.data());
+    return this->flatVelocities;
+}
+
+double CsvDataSet::getMaxMass() const {
+    return this->mMax;
+}
+
+/**
+ * @brief Loads a CSV file from the snapshot file next to it, which is created on the first load
+ *
+ * The snapshot is only used if it has been written after the CSV file was modified. If it can't be written (e.g. in a
+ * read-only directory), the parsed bodies are used directly and the CSV file is parsed again on the next load.
+ *
+ * @param fileName path of the CSV file
+ * @param dt time step stored in the snapshot
+ * @param gravitationalConstant G stored in the snapshot
+ * @return AbstractData* the bodies, allocated with new
+ */
+AbstractData *loadCsvDataSet(const std::string &fileName, double dt, double gravitationalConstant) {
+    boost::filesystem::path csvPath(fileName);
+    boost::filesystem::path snapshotPath = boost::filesystem::path(csvPath).replace_extension(".nbody");
+    try {
+        if (!boost::filesystem::exists(csvPath))
+            throw std::runtime_error("Can't open " + fileName);
+        // a snapshot with the same time stamp may have been written before the CSV file within the timer resolution
+        if (boost::filesystem::exists(snapshotPath) && boost::filesystem::last_write_time(snapshotPath) > boost::filesystem::last_write_time(csvPath))
+            return new SnapshotDataSet(snapshotPath.string());
+    } catch (const boost::filesystem::filesystem_error &e) {
+        throw std::runtime_error(e.what());
+    }
+    CsvDataSet *data = new CsvDataSet(fileName);
+    try {
+        writeSnapshot(snapshotPath.string(), *data, 0, dt, gravitationalConstant);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << ", the CSV file is used without a snapshot" << std::endl;
+    }
+    return data;
+}
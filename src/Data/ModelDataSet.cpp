@@ -0,0 +1,253 @@
+/**
+ * @file ModelDataSet.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains data sets sampled from equilibrium models of star clusters and galaxies
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Data/ModelDataSet.hpp"
+#include "../../include/Data/CounterRandom.hpp"
+
+#include <algorithm>
+#include <boost/math/special_functions/bessel.hpp>
+#include <cmath>
+#include <stdexcept>
+
+static const double pi = 3.141592653589793;
+static const double plummerTruncation = 20;  //!< Outermost radius in scale radii
+static const double hernquistTruncation = 200;//!< Outermost radius in scale radii
+static const double diskTruncation = 10;     //!< Outermost radius in scale lengths
+static const double diskScaleHeight = 0.05;  //!< Scale height in scale lengths
+static const std::size_t centerOfMassBlock = 4096;
+
+/**
+ * @brief Converts the name used on the command line to a model
+ *
+ * @return false if the name is unknown
+ */
+bool parseModel(const std::string &name, Model &model) {
+    if (name == "Plummer")
+        model = Model::PLUMMER;
+    else if (name == "Hernquist")
+        model = Model::HERNQUIST;
+    else if (name == "Disk")
+        model = Model::DISK;
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Fraction of the mass of an exponential disk within x scale lengths
+ */
+static double diskMassFraction(double x) {
+    return 1 - (1 + x) * std::exp(-x);
+}
+
+/**
+ * @brief Inverts diskMassFraction() by bisection (it has no closed-form inverse)
+ */
+static double diskRadius(double fraction) {
+    double lower = 0, upper = diskTruncation;
+    for (int i = 0; i < 64; ++i) {
+        double middle = 0.5 * (lower + upper);
+        (diskMassFraction(middle) < fraction ? lower : upper) = middle;
+    }
+    return 0.5 * (lower + upper);
+}
+
+/**
+ * @brief Returns a vector of the given length in a uniformly distributed direction
+ */
+static void isotropic(CounterRandom &random, double length, double vector[3]) {
+    double z = random.uniform(-1, 1);
+    double phi = random.uniform(0, 2 * pi);
+    double r = std::sqrt(std::max(0.0, 1 - z * z));
+    vector[0] = length * r * std::cos(phi);
+    vector[1] = length * r * std::sin(phi);
+    vector[2] = length * z;
+}
+
+/**
+ * @brief Samples a Plummer sphere (Aarseth, Henon & Wielen 1974)
+ */
+static void samplePlummer(CounterRandom &random, double G, double M, double a, double position[3], double velocity[3]) {
+    // cumulative mass M(r) / M = r^3 / (r^2 + a^2)^(3/2)
+    double maximum = std::pow(plummerTruncation * plummerTruncation / (plummerTruncation * plummerTruncation + 1), 1.5);
+    double fraction = random.uniform(0, maximum);
+    double r = fraction > 0 ? a / std::sqrt(std::pow(fraction, -2.0 / 3.0) - 1) : 0;
+    isotropic(random, r, position);
+
+    // speed in units of the escape speed has the density q^2 (1 - q^2)^(7/2), whose maximum is below 0.1
+    double q, g;
+    do {
+        q = random.uniform();
+        g = random.uniform(0, 0.1);
+    } while (g > q * q * std::pow(1 - q * q, 3.5));
+    double escapeSpeed = std::sqrt(2 * G * M) * std::pow(r * r + a * a, -0.25);
+    isotropic(random, q * escapeSpeed, velocity);
+}
+
+/**
+ * @brief Samples a Hernquist sphere with velocity dispersion from the isotropic Jeans equation (Hernquist 1990)
+ */
+static void sampleHernquist(CounterRandom &random, double G, double M, double a, double position[3], double velocity[3]) {
+    // cumulative mass M(r) / M = r^2 / (r + a)^2
+    double maximum = std::pow(hernquistTruncation / (hernquistTruncation + 1), 2);
+    double s = std::sqrt(random.uniform(0, maximum));
+    double r = a * s / (1 - s);
+    isotropic(random, r, position);
+
+    double x = r / a;
+    double dispersion = 0;
+    if (x > 0) {
+        dispersion = G * M / (12 * a) * (12 * x * std::pow(1 + x, 3) * std::log((1 + x) / x) - x / (1 + x) * (25 + 52 * x + 42 * x * x + 12 * x * x * x));
+    }
+    double sigma = std::sqrt(std::max(dispersion, 0.0));
+    double escapeSpeed = std::sqrt(2 * G * M / (r + a));
+    // bodies faster than the escape speed would leave the system
+    do {
+        for (int c = 0; c < 3; ++c)
+            velocity[c] = random.normal(0, sigma);
+    } while (velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2] >= escapeSpeed * escapeSpeed);
+}
+
+/**
+ * @brief Samples a thin exponential disk on circular orbits (rotation curve of Freeman 1970)
+ */
+static void sampleDisk(CounterRandom &random, double G, double M, double a, double position[3], double velocity[3]) {
+    double R = a * diskRadius(random.uniform(0, diskMassFraction(diskTruncation)));
+    double phi = random.uniform(0, 2 * pi);
+    // sech^2 profile: z = h * atanh(2u - 1)
+    double u = std::min(std::max(random.uniform(), 1e-12), 1 - 1e-12);
+    position[0] = R * std::cos(phi);
+    position[1] = R * std::sin(phi);
+    position[2] = diskScaleHeight * a * std::atanh(2 * u - 1);
+
+    double y = R / (2 * a);
+    double circularSpeed = 0;
+    if (y > 0) {
+        // the C++17 special functions are not provided by every standard library (e.g. libc++)
+        double bessel = boost::math::cyl_bessel_i(0, y) * boost::math::cyl_bessel_k(0, y) - boost::math::cyl_bessel_i(1, y) * boost::math::cyl_bessel_k(1, y);
+        circularSpeed = std::sqrt(std::max(0.0, 2 * G * M / a * y * y * bessel));
+    }
+    velocity[0] = -circularSpeed * std::sin(phi);
+    velocity[1] = circularSpeed * std::cos(phi);
+    velocity[2] = 0;
+}
+
+/**
+ * @brief Samples the bodies of a model
+ *
+ * @param model density model
+ * @param nbody number of bodies
+ * @param seed seed of the random streams
+ * @param totalMass mass of all bodies in kg
+ * @param scaleRadius scale radius (scale length of the disk) in m
+ * @param gravitationalConstant G used by the engines
+ */
+ModelDataSet::ModelDataSet(Model model, std::size_t nbody, uint64_t seed, double totalMass, double scaleRadius, double gravitationalConstant) {
+    if (nbody == 0)
+        throw std::invalid_argument("A model needs at least one body");
+    const char *names[] = {"PLUMMER", "HERNQUIST", "DISK"};
+    this->name = std::string(names[static_cast<int>(model)]) + " MODEL";
+    this->size = nbody;
+    this->positions.resize(nbody);
+    this->velocities.resize(nbody);
+    this->masses.assign(nbody, static_cast<float>(totalMass / nbody));
+
+    const double G = gravitationalConstant;
+    const double M = totalMass;
+    const double a = scaleRadius;
+#pragma omp parallel for default(none) shared(model, nbody, seed, G, M, a)
+    for (std::size_t i = 0; i < nbody; ++i) {
+        CounterRandom random(seed, i);
+        double position[3], velocity[3];
+        switch (model) {
+            case Model::PLUMMER:
+                samplePlummer(random, G, M, a, position, velocity);
+                break;
+            case Model::HERNQUIST:
+                sampleHernquist(random, G, M, a, position, velocity);
+                break;
+            case Model::DISK:
+                sampleDisk(random, G, M, a, position, velocity);
+                break;
+        }
+        this->positions[i] = float3(position[0], position[1], position[2]);
+        this->velocities[i] = float3(velocity[0], velocity[1], velocity[2]);
+    }
+
+    // fixed blocks summed in a fixed order keep the center of mass independent of the number of threads
+    const std::size_t blockCount = (nbody + centerOfMassBlock - 1) / centerOfMassBlock;
+    std::vector<double> blockSums(6 * blockCount, 0.0);
+#pragma omp parallel for default(none) shared(nbody, blockCount, blockSums)
+    for (std::size_t block = 0; block < blockCount; ++block) {
+        std::size_t end = std::min(nbody, (block + 1) * centerOfMassBlock);
+        for (std::size_t i = block * centerOfMassBlock; i < end; ++i) {
+            blockSums[6 * block + 0] += this->positions[i].x;
+            blockSums[6 * block + 1] += this->positions[i].y;
+            blockSums[6 * block + 2] += this->positions[i].z;
+            blockSums[6 * block + 3] += this->velocities[i].x;
+            blockSums[6 * block + 4] += this->velocities[i].y;
+            blockSums[6 * block + 5] += this->velocities[i].z;
+        }
+    }
+    double center[6] = {};
+    for (std::size_t block = 0; block < blockCount; ++block) {
+        for (int c = 0; c < 6; ++c)
+            center[c] += blockSums[6 * block + c];
+    }
+    // all bodies have the same mass
+    const float3 centerPosition(center[0] / nbody, center[1] / nbody, center[2] / nbody);
+    const float3 centerVelocity(center[3] / nbody, center[4] / nbody, center[5] / nbody);
+    double vMax = 0;
+#pragma omp parallel for default(none) shared(nbody, centerPosition, centerVelocity) reduction(max : vMax)
+    for (std::size_t i = 0; i < nbody; ++i) {
+        float3 &p = this->positions[i];
+        float3 &v = this->velocities[i];
+        p = float3(p.x - centerPosition.x, p.y - centerPosition.y, p.z - centerPosition.z);
+        v = float3(v.x - centerVelocity.x, v.y - centerVelocity.y, v.z - centerVelocity.z);
+        vMax = std::max(vMax, static_cast<double>(std::max({std::fabs(v.x), std::fabs(v.y), std::fabs(v.z)})));
+    }
+
+    // the view scale is the radius which contains 95% of the mass
+    switch (model) {
+        case Model::PLUMMER:
+            this->pMax = a / std::sqrt(std::pow(0.95, -2.0 / 3.0) - 1);
+            break;
+        case Model::HERNQUIST:
+            this->pMax = a * std::sqrt(0.95) / (1 - std::sqrt(0.95));
+            break;
+        case Model::DISK:
+            this->pMax = a * diskRadius(0.95);
+            break;
+    }
+    this->pMin = 0;
+    this->vMax = vMax;
+    this->vMin = 0;
+    this->mMax = totalMass / nbody;
+    // lower end of the logarithmic mass scale of the shader, which divides by log(mMax) - log(mMin)
+    this->mMin = this->mMax / 10;
+
+    this->flatPositions.resize(3 * nbody);
+    this->flatVelocities.resize(3 * nbody);
+}
+
+std::vector<float> ModelDataSet::getFlatPositions() {
+    this->writeFlatPositions(this->flatPositions.data());
+    return this->flatPositions;
+}
+
+std::vector<float> ModelDataSet::getFlatVelocities() {
+    this->writeFlatVelocities(this->flatVelocities.data());
+    return this->flatVelocities;
+}
+
+double ModelDataSet::getMaxMass() const {
+    return this->mMax;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file Snapshot.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the writer of the binary snapshot format
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Data/Snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Rounds an offset up to the alignment of the arrays
+ */
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+}
+
+/**
+ * @brief Writes one component of a float3 array as a contiguous float array, starting at the current file position.
+ *
+ * @param file opened file
+ * @param values the vectors
+ * @param component 0 (x), 1 (y) or 2 (z)
+ */
+static void writeComponent(std::ofstream &file, const std::vector<float3> &values, int component) {
+    // converted in chunks so that a multi-million body snapshot needs no second copy of the data set
+    std::vector<float> chunk(std::size_t(1) << 16);
+    for (std::size_t begin = 0; begin < values.size(); begin += chunk.size()) {
+        std::size_t count = std::min(chunk.size(), values.size() - begin);
+        for (std::size_t i = 0; i < count; ++i) {
+            const float3 &value = values[begin + i];
+            chunk[i] = component == 0 ? value.x : component == 1 ? value.y : value.z;
+        }
+        file.write(reinterpret_cast<const char *>(chunk.data()), count * sizeof(float));
+    }
+}
+
+/**
+ * @brief Pads the file with zeros up to the given offset
+ */
+static void padTo(std::ofstream &file, uint64_t offset) {
+    static const char zeros[snapshotAlignment] = {};
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros, offset - position);
+}
+
+/**
+ * @brief Saves the state of a data set as a snapshot file.
+ *
+ * The file is written next to the target and renamed afterwards, so an interrupted checkpoint never
+ * destroys the previous one.
+ *
+ * @param fileName path of the snapshot
+ * @param data the bodies
+ * @param step number of steps simulated so far
+ * @param dt time step in seconds
+ * @param gravitationalConstant G used by the engines
+ */
+void writeSnapshot(const std::string &fileName, const AbstractData &data, std::size_t step, double dt, double gravitationalConstant) {
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.nbody = data.size;
+    header.step = step;
+    header.time = step * dt;
+    header.dt = dt;
+    header.gravitationalConstant = gravitationalConstant;
+    header.integrator = static_cast<uint32_t>(Integrator::SEMI_IMPLICIT_EULER);
+    header.pMax = data.pMax;
+    header.pMin = data.pMin;
+    header.vMax = data.vMax;
+    header.vMin = data.vMin;
+    header.mMax = data.getMaxMass();
+    header.mMin = data.mMin;
+    uint64_t arrayBytes = data.size * sizeof(float);
+    header.positionsOffset = alignOffset(sizeof(SnapshotHeader));
+    header.velocitiesOffset = alignOffset(header.positionsOffset + 3 * arrayBytes);
+    header.massesOffset = alignOffset(header.velocitiesOffset + 3 * arrayBytes);
+    header.fileSize = header.massesOffset + arrayBytes;
+
+    std::string temporaryFileName = fileName + ".tmp";
+    std::ofstream file(temporaryFileName, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Can't write snapshot " + temporaryFileName);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    padTo(file, header.positionsOffset);
+    for (int component = 0; component < 3; ++component)
+        writeComponent(file, data.positions, component);
+    padTo(file, header.velocitiesOffset);
+    for (int component = 0; component < 3; ++component)
+        writeComponent(file, data.velocities, component);
+    padTo(file, header.massesOffset);
+    file.write(reinterpret_cast<const char *>(data.masses.data()), arrayBytes);
+    file.close();
+    if (!file)
+        throw std::runtime_error("Can't write snapshot " + temporaryFileName);
+
+    // std::rename doesn't replace existing files on Windows
+    std::remove(fileName.c_str());
+    if (std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+        throw std::runtime_error("Can't rename " + temporaryFileName + " to " + fileName);
+}
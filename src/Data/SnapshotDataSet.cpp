@@ -0,0 +1,105 @@
+/**
+ * @file SnapshotDataSet.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains implementations for data sets restored from snapshot files
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Data/SnapshotDataSet.hpp"
+#include "../../include/Data/Snapshot.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @brief Maps a snapshot file and restores its bodies.
+ *
+ * @param fileName path of the snapshot
+ */
+SnapshotDataSet::SnapshotDataSet(const std::string &fileName) {
+    boost::interprocess::mapped_region region;
+    try {
+        boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_only);
+        region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only);
+    } catch (const boost::interprocess::interprocess_exception &e) {
+        throw std::runtime_error("Can't open snapshot " + fileName + ": " + e.what());
+    }
+    region.advise(boost::interprocess::mapped_region::advice_sequential);
+    const char *base = static_cast<const char *>(region.get_address());
+    std::size_t fileSize = region.get_size();
+
+    SnapshotHeader header;
+    if (fileSize < sizeof(header))
+        throw std::runtime_error(fileName + " is not a snapshot file");
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0)
+        throw std::runtime_error(fileName + " is not a snapshot file");
+    if (header.version != snapshotVersion || header.headerSize < sizeof(SnapshotHeader))
+        throw std::runtime_error(fileName + " has snapshot version " + std::to_string(header.version) + ", expected " + std::to_string(snapshotVersion));
+    if (header.integrator != static_cast<uint32_t>(Integrator::SEMI_IMPLICIT_EULER))
+        throw std::runtime_error(fileName + " was written by an unknown integrator");
+    uint64_t arrayBytes = header.nbody * sizeof(float);
+    if (header.fileSize != fileSize || header.positionsOffset + 3 * arrayBytes > fileSize ||
+        header.velocitiesOffset + 3 * arrayBytes > fileSize || header.massesOffset + arrayBytes > fileSize)
+        throw std::runtime_error(fileName + " is truncated");
+
+    this->name = "SNAPSHOT " + fileName;
+    this->size = header.nbody;
+    this->step = header.step;
+    this->time = header.time;
+    this->dt = header.dt;
+    this->pMax = header.pMax;
+    this->pMin = header.pMin;
+    this->vMax = header.vMax;
+    this->vMin = header.vMin;
+    this->mMax = header.mMax;
+    this->mMin = header.mMin;
+
+    const float *positions = reinterpret_cast<const float *>(base + header.positionsOffset);
+    const float *velocities = reinterpret_cast<const float *>(base + header.velocitiesOffset);
+    const float *masses = reinterpret_cast<const float *>(base + header.massesOffset);
+    this->positions.resize(this->size);
+    this->velocities.resize(this->size);
+    this->masses.assign(masses, masses + this->size);
+    const std::size_t n = this->size;
+#pragma omp parallel for default(none) shared(positions, velocities, n)
+    for (std::size_t i = 0; i < n; ++i) {
+        this->positions[i] = float3(positions[i], positions[n + i], positions[2 * n + i]);
+        this->velocities[i] = float3(velocities[i], velocities[n + i], velocities[2 * n + i]);
+    }
+
+    this->flatPositions.resize(3 * this->size);
+    this->flatVelocities.resize(3 * this->size);
+}
+
+std::vector<float> SnapshotDataSet::getFlatPositions() {
+    this->writeFlatPositions(this->flatPositions.data());
+    return this->flatPositions;
+}
+
+std::vector<float> SnapshotDataSet::getFlatVelocities() {
+    this->writeFlatVelocities(this->flatVelocities.data());
+    return this->flatVelocities;
+}
+
+double SnapshotDataSet::getMaxMass() const {
+    return this->mMax;
+}
+
+std::size_t SnapshotDataSet::getStep() const {
+    return this->step;
+}
+
+double SnapshotDataSet::getTime() const {
+    return this->time;
+}
+
+double SnapshotDataSet::getTimeStep() const {
+    return this->dt;
+}
@@ -0,0 +1,489 @@
+/**
+ * @file TrajectoryCodec.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the lossy codec of compressed trajectory frames
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Data/TrajectoryCodec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+static const uint32_t ransLowerBound = 1u << 23;
+static const uint32_t probabilityScale = 1u << trajectoryProbabilityBits;
+
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static void putVarint(std::vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * @brief Reads a varint and advances position
+ *
+ * @return false if the bytes end before the varint
+ */
+static bool getVarint(const uint8_t *bytes, std::size_t size, std::size_t &position, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && position < size; shift += 7) {
+        uint8_t byte = bytes[position++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Spreads the lower 21 bits of a value to every third bit
+ */
+static uint64_t spreadBits(uint64_t value) {
+    value &= 0x1fffff;
+    value = (value | value << 32) & 0x1f00000000ffffULL;
+    value = (value | value << 16) & 0x1f0000ff0000ffULL;
+    value = (value | value << 8) & 0x100f00f00f00f00fULL;
+    value = (value | value << 4) & 0x10c30c30c30c30c3ULL;
+    value = (value | value << 2) & 0x1249249249249249ULL;
+    return value;
+}
+
+/**
+ * @brief Rounds a value to the grid given by origin and quantum
+ *
+ * Non-finite values are mapped to the origin, values far outside the grid are clamped.
+ */
+static int64_t quantize(float value, double origin, double quantum) {
+    double scaled = (static_cast<double>(value) - origin) / quantum;
+    if (!std::isfinite(scaled))
+        return 0;
+    const double limit = 4.0e18;
+    return std::llround(std::max(-limit, std::min(limit, scaled)));
+}
+
+/**
+ * @brief Scales a histogram to frequencies which sum up to probabilityScale; every occurring byte keeps at least 1
+ */
+static void normalizeFrequencies(const uint32_t counts[256], std::size_t total, uint16_t frequencies[256]) {
+    uint32_t sum = 0;
+    int largest = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        frequencies[symbol] = 0;
+        if (counts[symbol] > 0) {
+            uint64_t scaled = static_cast<uint64_t>(counts[symbol]) * probabilityScale / total;
+            frequencies[symbol] = static_cast<uint16_t>(std::max<uint64_t>(scaled, 1));
+        }
+        sum += frequencies[symbol];
+        if (counts[symbol] > counts[largest])
+            largest = symbol;
+    }
+    // rounding down can only leave a deficit, the minimum of 1 an excess
+    if (sum < probabilityScale) {
+        frequencies[largest] += probabilityScale - sum;
+        return;
+    }
+    while (sum > probabilityScale) {
+        int symbol = static_cast<int>(std::max_element(frequencies, frequencies + 256) - frequencies);
+        --frequencies[symbol];
+        --sum;
+    }
+}
+
+/**
+ * @brief Codes bytes with a byte-wise rANS coder
+ *
+ * @param in bytes to code
+ * @param size number of bytes
+ * @param frequencies normalized frequencies of all bytes
+ * @param out receives the coded bytes
+ */
+static void ransEncode(const uint8_t *in, std::size_t size, const uint16_t frequencies[256], std::vector<uint8_t> &out) {
+    uint32_t starts[256];
+    uint32_t start = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        starts[symbol] = start;
+        start += frequencies[symbol];
+    }
+    // a symbol emits at most trajectoryProbabilityBits bits, the final state 4 bytes
+    out.resize(2 * size + 4);
+    uint8_t *end = out.data() + out.size();
+    uint8_t *position = end;
+    uint32_t state = ransLowerBound;
+    // rANS is last in, first out: the bytes are coded backwards so that the decoder reads forwards
+    for (std::size_t i = size; i-- > 0;) {
+        uint32_t frequency = frequencies[in[i]];
+        uint32_t stateMax = ((ransLowerBound >> trajectoryProbabilityBits) << 8) * frequency;
+        while (state >= stateMax) {
+            *--position = static_cast<uint8_t>(state);
+            state >>= 8;
+        }
+        state = ((state / frequency) << trajectoryProbabilityBits) + state % frequency + starts[in[i]];
+    }
+    position -= 4;
+    for (int byte = 0; byte < 4; ++byte)
+        position[byte] = static_cast<uint8_t>(state >> (8 * byte));
+    out.erase(out.begin(), out.begin() + (position - out.data()));
+}
+
+/**
+ * @brief Decodes bytes coded by ransEncode
+ *
+ * @return false if the coded bytes are malformed
+ */
+static bool ransDecode(const uint8_t *in, std::size_t codedSize, const uint16_t frequencies[256], uint8_t *out, std::size_t size) {
+    uint32_t starts[256];
+    uint8_t symbols[probabilityScale];
+    uint32_t start = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        starts[symbol] = start;
+        if (start + frequencies[symbol] > probabilityScale)
+            return false;
+        std::memset(symbols + start, symbol, frequencies[symbol]);
+        start += frequencies[symbol];
+    }
+    if (start != probabilityScale || codedSize < 4)
+        return false;
+    uint32_t state = in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+    std::size_t position = 4;
+    for (std::size_t i = 0; i < size; ++i) {
+        uint32_t slot = state & (probabilityScale - 1);
+        uint8_t symbol = symbols[slot];
+        out[i] = symbol;
+        state = frequencies[symbol] * (state >> trajectoryProbabilityBits) + slot - starts[symbol];
+        while (state < ransLowerBound) {
+            if (position >= codedSize)
+                return false;
+            state = state << 8 | in[position++];
+        }
+    }
+    return true;
+}
+
+static std::size_t chunkCountOf(std::size_t nbody) {
+    return (nbody + trajectoryChunkBodies - 1) / trajectoryChunkBodies;
+}
+
+/**
+ * @brief Creates an encoder
+ *
+ * @param nbody number of bodies of every frame
+ * @param velocities whether the frames contain velocities after the positions
+ * @param relativeError error bound relative to the extent of the bounding box
+ * @param keyframeInterval number of frames between two keyframes
+ */
+TrajectoryEncoder::TrajectoryEncoder(std::size_t nbody, bool velocities, double relativeError, std::size_t keyframeInterval)
+    : nbody(nbody), components(velocities ? 6 : 3), relativeError(relativeError), keyframeInterval(std::max<std::size_t>(keyframeInterval, 1)),
+      permutation(nbody), current(components * nbody), previous(components * nbody), chunkBuffers(chunkCountOf(nbody)) {
+    if (!(relativeError > 0))
+        throw std::invalid_argument("The error bound of a compressed trajectory must be positive");
+    std::memset(&coding, 0, sizeof(coding));
+    coding.chunkCount = static_cast<uint32_t>(chunkBuffers.size());
+}
+
+/**
+ * @brief Chooses the quantization grids and the Morton order of the following frames
+ *
+ * @param frame flat positions, followed by the flat velocities if they are recorded
+ */
+void TrajectoryEncoder::startKeyframe(const float *frame) {
+    double positionExtent = 0;
+    for (int set = 0; set < components / 3; ++set) {
+        const float *values = frame + set * 3 * nbody;
+        double minimum[3], maximum[3];
+        for (int c = 0; c < 3; ++c) {
+            minimum[c] = std::numeric_limits<double>::max();
+            maximum[c] = std::numeric_limits<double>::lowest();
+        }
+        for (std::size_t i = 0; i < nbody; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                double value = values[3 * i + c];
+                if (!std::isfinite(value))
+                    continue;
+                minimum[c] = std::min(minimum[c], value);
+                maximum[c] = std::max(maximum[c], value);
+            }
+        }
+        double extent = 0;
+        for (int c = 0; c < 3; ++c) {
+            if (minimum[c] > maximum[c])
+                minimum[c] = maximum[c] = 0;
+            extent = std::max(extent, maximum[c] - minimum[c]);
+        }
+        double *origin = set == 0 ? coding.positionOrigin : coding.velocityOrigin;
+        double &quantum = set == 0 ? coding.positionQuantum : coding.velocityQuantum;
+        std::copy(minimum, minimum + 3, origin);
+        // rounding to the nearest grid point is off by at most half a quantum
+        quantum = extent > 0 ? 2 * relativeError * extent : 1;
+        if (set == 0)
+            positionExtent = extent;
+    }
+
+    // Morton codes of a 2^21 grid over the bounding box
+    const double cells = (1 << 21) - 1;
+    const double cell = positionExtent > 0 ? positionExtent / cells : 1;
+    std::vector<std::pair<uint64_t, uint32_t>> codes(nbody);
+    for (std::size_t i = 0; i < nbody; ++i) {
+        uint64_t code = 0;
+        for (int c = 0; c < 3; ++c) {
+            double scaled = (frame[3 * i + c] - coding.positionOrigin[c]) / cell;
+            uint64_t cellIndex = std::isfinite(scaled) ? static_cast<uint64_t>(std::max(0.0, std::min(scaled, cells))) : 0;
+            code |= spreadBits(cellIndex) << c;
+        }
+        codes[i] = std::make_pair(code, static_cast<uint32_t>(i));
+    }
+    std::sort(codes.begin(), codes.end());
+    for (std::size_t slot = 0; slot < nbody; ++slot)
+        permutation[slot] = codes[slot].second;
+}
+
+/**
+ * @brief Codes component-major values as a stream of independent chunks
+ *
+ * @param values values in Morton order, streamComponents blocks of nbody values
+ * @param reference values of the previous frame, or nullptr to code the difference to the previous body
+ * @param streamComponents number of components
+ * @param out receives the chunk size table and the chunks
+ */
+void TrajectoryEncoder::encodeStream(const std::vector<int64_t> &values, const std::vector<int64_t> *reference, int streamComponents, std::vector<char> &out) {
+    const std::size_t chunkCount = chunkBuffers.size();
+    for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        std::size_t begin = chunk * trajectoryChunkBodies;
+        std::size_t end = std::min<std::size_t>(begin + trajectoryChunkBodies, nbody);
+        std::vector<uint8_t> raw;
+        raw.reserve(streamComponents * (end - begin) * 2);
+        for (int c = 0; c < streamComponents; ++c) {
+            const int64_t *componentValues = values.data() + c * nbody;
+            int64_t predicted = 0;
+            for (std::size_t slot = begin; slot < end; ++slot) {
+                if (reference != nullptr)
+                    predicted = (*reference)[c * nbody + slot];
+                putVarint(raw, zigzag(componentValues[slot] - predicted));
+                predicted = componentValues[slot];
+            }
+        }
+
+        uint32_t counts[256] = {};
+        for (uint8_t byte : raw)
+            ++counts[byte];
+        uint16_t frequencies[256];
+        std::vector<uint8_t> coded;
+        if (!raw.empty()) {
+            normalizeFrequencies(counts, raw.size(), frequencies);
+            ransEncode(raw.data(), raw.size(), frequencies, coded);
+        }
+
+        TrajectoryChunkHeader header;
+        header.rawBytes = static_cast<uint32_t>(raw.size());
+        header.mode = !raw.empty() && coded.size() + sizeof(frequencies) < raw.size() ? 1 : 0;
+        const std::vector<uint8_t> &payload = header.mode == 1 ? coded : raw;
+        header.codedBytes = static_cast<uint32_t>(payload.size());
+        std::vector<char> &buffer = chunkBuffers[chunk];
+        buffer.resize(sizeof(header) + (header.mode == 1 ? sizeof(frequencies) : 0) + payload.size());
+        char *position = buffer.data();
+        std::memcpy(position, &header, sizeof(header));
+        position += sizeof(header);
+        if (header.mode == 1) {
+            std::memcpy(position, frequencies, sizeof(frequencies));
+            position += sizeof(frequencies);
+        }
+        if (!payload.empty())
+            std::memcpy(position, payload.data(), payload.size());
+    }
+
+    for (const std::vector<char> &buffer : chunkBuffers) {
+        uint32_t size = static_cast<uint32_t>(buffer.size());
+        out.insert(out.end(), reinterpret_cast<const char *>(&size), reinterpret_cast<const char *>(&size) + sizeof(size));
+    }
+    for (const std::vector<char> &buffer : chunkBuffers)
+        out.insert(out.end(), buffer.begin(), buffer.end());
+}
+
+/**
+ * @brief Compresses a frame
+ *
+ * @param frame flat positions of all bodies, followed by the flat velocities if they are recorded
+ * @param out receives the compressed frame
+ */
+void TrajectoryEncoder::encode(const float *frame, std::vector<char> &out) {
+    bool keyframe = frameCount % keyframeInterval == 0;
+    if (keyframe)
+        startKeyframe(frame);
+    coding.keyframe = keyframe ? 1 : 0;
+
+    for (std::size_t slot = 0; slot < nbody; ++slot) {
+        std::size_t body = permutation[slot];
+        for (int c = 0; c < components; ++c) {
+            float value = frame[(c / 3) * 3 * nbody + 3 * body + c % 3];
+            current[c * nbody + slot] = c < 3 ? quantize(value, coding.positionOrigin[c], coding.positionQuantum)
+                                              : quantize(value, coding.velocityOrigin[c - 3], coding.velocityQuantum);
+        }
+    }
+
+    out.clear();
+    out.insert(out.end(), reinterpret_cast<const char *>(&coding), reinterpret_cast<const char *>(&coding) + sizeof(coding));
+    if (keyframe) {
+        std::vector<int64_t> order(permutation.begin(), permutation.end());
+        encodeStream(order, nullptr, 1, out);
+    }
+    encodeStream(current, keyframe ? nullptr : &previous, components, out);
+    std::swap(current, previous);
+    ++frameCount;
+}
+
+/**
+ * @brief Decodes a stream written by TrajectoryEncoder::encodeStream
+ *
+ * @param data the stream
+ * @param size number of bytes left in the frame
+ * @param nbody number of bodies
+ * @param streamComponents number of components
+ * @param values values of the previous frame, replaced by the decoded values
+ * @param differential whether the values are relative to the previous frame
+ * @return number of bytes of the stream
+ */
+static std::size_t decodeStream(const char *data, std::size_t size, std::size_t nbody, int streamComponents, int64_t *values, bool differential) {
+    const std::size_t chunkCount = chunkCountOf(nbody);
+    if (size < chunkCount * sizeof(uint32_t))
+        throw std::runtime_error("Compressed trajectory frame is truncated");
+    std::vector<std::size_t> offsets(chunkCount + 1);
+    offsets[0] = chunkCount * sizeof(uint32_t);
+    for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        uint32_t chunkSize;
+        std::memcpy(&chunkSize, data + chunk * sizeof(uint32_t), sizeof(chunkSize));
+        offsets[chunk + 1] = offsets[chunk] + chunkSize;
+    }
+    if (offsets[chunkCount] > size)
+        throw std::runtime_error("Compressed trajectory frame is truncated");
+
+    int malformed = 0;
+#pragma omp parallel for default(none) shared(data, nbody, streamComponents, values, differential, chunkCount, offsets) reduction(| : malformed) schedule(dynamic)
+    for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        const char *position = data + offsets[chunk];
+        std::size_t chunkSize = offsets[chunk + 1] - offsets[chunk];
+        TrajectoryChunkHeader header;
+        if (chunkSize < sizeof(header)) {
+            malformed = 1;
+            continue;
+        }
+        std::memcpy(&header, position, sizeof(header));
+        position += sizeof(header);
+        std::vector<uint8_t> decoded;
+        const uint8_t *raw = reinterpret_cast<const uint8_t *>(position);
+        if (header.mode == 1) {
+            uint16_t frequencies[256];
+            if (chunkSize != sizeof(header) + sizeof(frequencies) + header.codedBytes) {
+                malformed = 1;
+                continue;
+            }
+            std::memcpy(frequencies, position, sizeof(frequencies));
+            decoded.resize(header.rawBytes);
+            if (!ransDecode(raw + sizeof(frequencies), header.codedBytes, frequencies, decoded.data(), decoded.size())) {
+                malformed = 1;
+                continue;
+            }
+            raw = decoded.data();
+        } else if (header.mode != 0 || header.codedBytes != header.rawBytes || chunkSize != sizeof(header) + header.rawBytes) {
+            malformed = 1;
+            continue;
+        }
+
+        std::size_t begin = chunk * trajectoryChunkBodies;
+        std::size_t end = std::min<std::size_t>(begin + trajectoryChunkBodies, nbody);
+        std::size_t bytePosition = 0;
+        for (int c = 0; c < streamComponents && !malformed; ++c) {
+            int64_t *componentValues = values + c * nbody;
+            int64_t last = 0;
+            for (std::size_t slot = begin; slot < end; ++slot) {
+                uint64_t coded;
+                if (!getVarint(raw, header.rawBytes, bytePosition, coded)) {
+                    malformed = 1;
+                    break;
+                }
+                int64_t predicted = differential ? componentValues[slot] : last;
+                last = componentValues[slot] = predicted + unzigzag(coded);
+            }
+        }
+    }
+    if (malformed)
+        throw std::runtime_error("Compressed trajectory frame is malformed");
+    return offsets[chunkCount];
+}
+
+/**
+ * @brief Creates a decoder
+ *
+ * @param nbody number of bodies of every frame
+ * @param velocities whether the frames contain velocities
+ */
+TrajectoryDecoder::TrajectoryDecoder(std::size_t nbody, bool velocities)
+    : nbody(nbody), components(velocities ? 6 : 3), permutation(nbody), values(components * nbody) {
+}
+
+/**
+ * @brief Whether a compressed frame can be decoded without the previous frames
+ */
+bool TrajectoryDecoder::isKeyframe(const char *data, std::size_t size) {
+    TrajectoryFrameCoding coding;
+    if (size < sizeof(coding))
+        return false;
+    std::memcpy(&coding, data, sizeof(coding));
+    return coding.keyframe == 1;
+}
+
+/**
+ * @brief Decompresses the next frame
+ *
+ * @param data the compressed frame
+ * @param size size of the compressed frame
+ * @param frame receives the flat positions, followed by the flat velocities if they are recorded
+ */
+void TrajectoryDecoder::decode(const char *data, std::size_t size, float *frame) {
+    TrajectoryFrameCoding coding;
+    if (size < sizeof(coding))
+        throw std::runtime_error("Compressed trajectory frame is truncated");
+    std::memcpy(&coding, data, sizeof(coding));
+    if (coding.chunkCount != chunkCountOf(nbody))
+        throw std::runtime_error("Compressed trajectory frame has a different number of bodies");
+    if (coding.keyframe != 1 && !hasKeyframe)
+        throw std::runtime_error("Compressed trajectory frames have to be decoded from a keyframe on");
+    std::size_t position = sizeof(coding);
+    if (coding.keyframe == 1) {
+        std::vector<int64_t> order(nbody);
+        position += decodeStream(data + position, size - position, nbody, 1, order.data(), false);
+        for (std::size_t slot = 0; slot < nbody; ++slot) {
+            if (order[slot] < 0 || static_cast<uint64_t>(order[slot]) >= nbody)
+                throw std::runtime_error("Compressed trajectory frame is malformed");
+            permutation[slot] = static_cast<uint32_t>(order[slot]);
+        }
+    }
+    decodeStream(data + position, size - position, nbody, components, values.data(), coding.keyframe != 1);
+    hasKeyframe = true;
+
+    const int componentCount = components;
+#pragma omp parallel for default(none) shared(frame, coding, componentCount)
+    for (std::size_t slot = 0; slot < nbody; ++slot) {
+        std::size_t body = permutation[slot];
+        for (int c = 0; c < componentCount; ++c) {
+            double value = c < 3 ? coding.positionOrigin[c] + coding.positionQuantum * values[c * nbody + slot]
+                                 : coding.velocityOrigin[c - 3] + coding.velocityQuantum * values[c * nbody + slot];
+            frame[(c / 3) * 3 * nbody + 3 * body + c % 3] = static_cast<float>(value);
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file TrajectoryRecorder.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains a recorder which streams trajectories to a binary file on a background thread
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Data/TrajectoryRecorder.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief Opens the file, writes its header and starts the writer thread.
+ *
+ * @param fileName path of the trajectory file (replaced if it exists)
+ * @param nbody number of bodies of every frame
+ * @param dt time step of the simulation in seconds
+ * @param velocities whether the velocities are recorded as well
+ * @param bufferCount number of frames which can wait for the writer
+ * @param policy what happens if all buffers are waiting
+ * @param relativeError error bound of the compressed frames relative to the bounding box; 0 writes raw frames
+ * @param keyframeInterval number of frames between two compressed keyframes
+ */
+TrajectoryRecorder::TrajectoryRecorder(const std::string &fileName, std::size_t nbody, double dt, bool velocities, std::size_t bufferCount, TrajectoryPolicy policy,
+                                       double relativeError, std::size_t keyframeInterval)
+    : nbody(nbody), velocities(velocities), policy(policy), frames(bufferCount), filledFrames(bufferCount), freeFrames(bufferCount) {
+    if (relativeError > 0)
+        encoder.reset(new TrajectoryEncoder(nbody, velocities, relativeError, keyframeInterval));
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Can't write trajectory " + fileName);
+
+    std::size_t floatsPerFrame = (velocities ? 6 : 3) * nbody;
+    TrajectoryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, trajectoryMagic, sizeof(header.magic));
+    header.version = trajectoryVersion;
+    header.headerSize = sizeof(TrajectoryHeader);
+    header.nbody = nbody;
+    header.flags = (velocities ? trajectoryHasVelocities : 0) | (encoder ? trajectoryCompressed : 0);
+    header.dt = dt;
+    header.frameBytes = encoder ? 0 : sizeof(TrajectoryFrameHeader) + floatsPerFrame * sizeof(float);
+    if (encoder) {
+        header.relativeError = relativeError;
+        header.keyframeInterval = static_cast<uint32_t>(keyframeInterval);
+        header.chunkBodies = trajectoryChunkBodies;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (Frame &frame : frames) {
+        std::memset(&frame.header, 0, sizeof(frame.header));
+        frame.header.payloadBytes = floatsPerFrame * sizeof(float);
+        frame.data.resize(floatsPerFrame);
+        freeFrames.push(&frame);
+    }
+    writer = std::thread(&TrajectoryRecorder::writeLoop, this);
+}
+
+/**
+ * @brief Writes the remaining frames, the index and the footer.
+ */
+TrajectoryRecorder::~TrajectoryRecorder() {
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+
+    TrajectoryFooter footer;
+    std::memset(&footer, 0, sizeof(footer));
+    footer.frameCount = index.size() / 2;
+    footer.indexOffset = static_cast<uint64_t>(file.tellp());
+    footer.droppedFrames = droppedFrames.load();
+    std::memcpy(footer.magic, trajectoryIndexMagic, sizeof(footer.magic));
+    file.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char *>(&footer), sizeof(footer));
+    file.close();
+
+    if (failed.load() || !file)
+        std::cerr << "The trajectory could not be written completely" << std::endl;
+    if (footer.droppedFrames > 0)
+        std::cerr << footer.droppedFrames << " trajectory frames were dropped because the writer fell behind" << std::endl;
+}
+
+/**
+ * @brief Hands a frame to the writer thread.
+ *
+ * Only copies the bodies into a free buffer; with TrajectoryPolicy::DROP it never waits.
+ *
+ * @param step simulation step of the frame
+ * @param data the bodies (must have the number of bodies given to the constructor)
+ * @return false if the frame was dropped
+ */
+bool TrajectoryRecorder::record(std::size_t step, const AbstractData &data) {
+    Frame *frame = nullptr;
+    while (!freeFrames.pop(frame)) {
+        if (policy == TrajectoryPolicy::DROP) {
+            droppedFrames.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    frame->header.step = step;
+    data.writeFlatPositions(frame->data.data());
+    if (velocities)
+        data.writeFlatVelocities(frame->data.data() + 3 * nbody);
+    // can't fail, the queue holds all buffers
+    filledFrames.push(frame);
+    return true;
+}
+
+/**
+ * @brief Body of the writer thread: writes frames until the recorder is destroyed and all frames are written.
+ */
+void TrajectoryRecorder::writeLoop() {
+    while (true) {
+        Frame *frame = nullptr;
+        if (filledFrames.pop(frame)) {
+            if (!failed.load(std::memory_order_relaxed)) {
+                const char *payload = reinterpret_cast<const char *>(frame->data.data());
+                if (encoder) {
+                    encoder->encode(frame->data.data(), encoded);
+                    payload = encoded.data();
+                    frame->header.payloadBytes = encoded.size();
+                }
+                index.push_back(frame->header.step);
+                index.push_back(static_cast<uint64_t>(file.tellp()));
+                file.write(reinterpret_cast<const char *>(&frame->header), sizeof(frame->header));
+                file.write(payload, frame->header.payloadBytes);
+                if (!file) {
+                    // e.g. disk full; the buffers are still recycled so that the simulation is not affected
+                    failed.store(true);
+                    index.resize(index.size() - 2);
+                }
+            }
+            freeFrames.push(frame);
+        } else if (stopping.load(std::memory_order_acquire)) {
+            // record() is not called anymore, so an empty queue means everything has been written
+            if (filledFrames.empty())
+                break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+std::size_t TrajectoryRecorder::getDroppedFrames() const {
+    return droppedFrames.load();
+}
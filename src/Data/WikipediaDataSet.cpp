@@ -10,12 +10,9 @@
  */
 
 #include <algorithm>
-#include <boost/random/mersenne_twister.hpp>
-#include <boost/random/normal_distribution.hpp>
-#include <boost/random/uniform_real_distribution.hpp>
 #include <cmath>
-#include <ctime>
 
+#include "../include/Data/CounterRandom.hpp"
 #include "../include/Data/WikipediaDataSet.hpp"
 
 /**
@@ -23,6 +20,7 @@
 * 
 * @param numberRandomObjects Amount of bodies (+ 9 which are default)
 * @param initDistribution Type of random distribution used for position initialization
+* @param seed Seed of the random bodies (the same seed always creates the same bodies)
 * @param mMax Maximum possible mass
 * @param mMin Minimum possible mass
 * @param pMax Maximum possible position
@@ -30,7 +28,7 @@
 * @param vMax Maximum possible velocity
 * @param vMin Minimum possible velocity
 */
-WikipediaDataSet::WikipediaDataSet(const std::size_t numberRandomObjects, std::string initDistribution, const double mMax, const double mMin, const double pMax, const double pMin, const double vMax, const double vMin) {
+WikipediaDataSet::WikipediaDataSet(const std::size_t numberRandomObjects, std::string initDistribution, const uint64_t seed, const double mMax, const double mMin, const double pMax, const double pMin, const double vMax, const double vMin) {
     this->name = "WIKIPEDIA DATA SET";
     this->pMax = pMax;
     this->pMin = pMin;
@@ -93,32 +91,32 @@ WikipediaDataSet::WikipediaDataSet(const std::size_t numberRandomObjects, std::s
     this->masses.emplace_back(102.413e24);
     this->size++;
 
-    // initialize random objects
-    boost::random::mt19937 gen;
-    gen.seed(std::time(0));
-    boost::random::normal_distribution<> normalDistPos(0.0, 1e11);
-    boost::random::uniform_real_distribution<> uniformDistPos(-pMax, pMax);
-    boost::random::uniform_real_distribution<> distVel(vMin, vMax);
+    // initialize random objects; every body has its own random stream, so they can be created in parallel
+    const std::size_t first = this->size;
+    this->size += numberRandomObjects;
+    this->positions.resize(this->size);
+    this->velocities.resize(this->size);
+    this->masses.resize(this->size);
+    const bool uniformPositions = initDistribution == "uniform";
     // In order to obtain better random values, we use log10 to also consider numbers on the left side of the interval
-    boost::random::uniform_real_distribution<> distMas(std::log10(mMin), std::log10(mMax));
-    for (size_t i = 0; i < numberRandomObjects; ++i) {
-        if (initDistribution == "normal") {
-            this->positions.emplace_back(
-                    normalDistPos(gen),
-                    normalDistPos(gen),
-                    normalDistPos(gen));
-        } else if (initDistribution == "uniform") {
-            this->positions.emplace_back(
-                    uniformDistPos(gen),
-                    uniformDistPos(gen),
-                    uniformDistPos(gen));
+    const double logMinMass = std::log10(mMin);
+    const double logMaxMass = std::log10(mMax);
+#pragma omp parallel for default(none) shared(numberRandomObjects, first, seed, uniformPositions, logMinMass, logMaxMass, pMax, vMin, vMax)
+    for (std::size_t i = 0; i < numberRandomObjects; ++i) {
+        CounterRandom random(seed, i);
+        if (uniformPositions) {
+            double x = random.uniform(-pMax, pMax);
+            double y = random.uniform(-pMax, pMax);
+            this->positions[first + i] = float3(x, y, random.uniform(-pMax, pMax));
+        } else {
+            double x = random.normal(0.0, 1e11);
+            double y = random.normal(0.0, 1e11);
+            this->positions[first + i] = float3(x, y, random.normal(0.0, 1e11));
         }
-        this->velocities.emplace_back(
-                distVel(gen),
-                distVel(gen),
-                distVel(gen));
-        this->masses.emplace_back(std::pow(10, distMas(gen)));
-        this->size++;
+        double vx = random.uniform(vMin, vMax);
+        double vy = random.uniform(vMin, vMax);
+        this->velocities[first + i] = float3(vx, vy, random.uniform(vMin, vMax));
+        this->masses[first + i] = std::pow(10, random.uniform(logMinMass, logMaxMass));
     }
 
     this->flatPositions.resize(3 * this->positions.size());
@@ -0,0 +1,106 @@
+/**
+* @file BenchmarkController.cpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a class which decides how long a benchmark run is warmed up and measured
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#include "../../include/PerformanceMetrics/BenchmarkController.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Creates a controller for one benchmark run.
+ *
+ * @param targetRelativeWidth target half width of the 95 % confidence interval relative to the mean, e.g. 0.02
+ * @param timeBudget maximum duration of warm-up and measurement in seconds; a quarter of it may be used for the warm-up
+ * @param windowSize number of samples used for the steady state detection
+ * @param steadyThreshold relative drift of a window which is always considered steady
+ * @param minSamples minimum number of measured samples (at least 2)
+ */
+BenchmarkController::BenchmarkController(double targetRelativeWidth, double timeBudget, std::size_t windowSize, double steadyThreshold, std::size_t minSamples)
+    : targetRelativeWidth(targetRelativeWidth), timeBudget(timeBudget), windowSize(windowSize), steadyThreshold(steadyThreshold),
+      minSamples(std::max<std::size_t>(minSamples, 2)) {}
+
+/**
+ * @brief Whether the samples of the rolling window are steady.
+ *
+ * The means of the older and the newer half of the window are compared. They may differ by the threshold relative to
+ * the mean or, for noisy but stationary step times, by twice the standard error of the difference, which is estimated
+ * from the rolling variance of the window.
+ *
+ * @return true if the window is full and its halves don't differ significantly
+ */
+bool BenchmarkController::isSteady() const {
+    if (this->window.size() < this->windowSize)
+        return false;
+    double sum = 0.0;
+    double olderSum = 0.0;
+    std::size_t half = this->window.size() / 2;
+    for (std::size_t i = 0; i < this->window.size(); ++i) {
+        sum += this->window[i];
+        if (i < half)
+            olderSum += this->window[i];
+    }
+    double mean = sum / this->window.size();
+    double variance = 0.0;
+    for (double t : this->window)
+        variance += (t - mean) * (t - mean);
+    variance /= this->window.size() - 1;
+    double olderMean = olderSum / half;
+    double newerMean = (sum - olderSum) / (this->window.size() - half);
+    double standardError = std::sqrt(variance / half + variance / (this->window.size() - half));
+    return std::abs(newerMean - olderMean) <= std::max(this->steadyThreshold * mean, 2.0 * standardError);
+}
+
+/**
+ * @brief Adds the time of one step and advances the state.
+ *
+ * @param t step time in seconds
+ * @return State state after the sample; the caller has to discard all previous measurements when it changes from WARM_UP to MEASURING
+ */
+BenchmarkController::State BenchmarkController::addSample(double t) {
+    double elapsed = (Core::getCurrentTime() - this->startTime).getSeconds();
+    if (this->state == State::WARM_UP) {
+        this->warmUpSteps++;
+        this->window.push_back(t);
+        if (this->window.size() > this->windowSize)
+            this->window.pop_front();
+        if (this->isSteady() || elapsed > 0.25 * this->timeBudget)
+            this->state = State::MEASURING;
+    } else if (this->state == State::MEASURING) {
+        this->measured.addTime(t);
+        if (this->measured.getCount() >= this->minSamples) {
+            this->converged = this->measured.getConfidenceHalfWidth() <= this->targetRelativeWidth * this->measured.getAvgTime();
+            if (this->converged || elapsed > this->timeBudget)
+                this->state = State::DONE;
+        }
+    }
+    return this->state;
+}
+
+BenchmarkController::State BenchmarkController::getState() const {
+    return this->state;
+}
+
+std::size_t BenchmarkController::getWarmUpSteps() const {
+    return this->warmUpSteps;
+}
+
+/**
+ * @brief Whether the confidence interval reached the target width (false if the time budget ran out before).
+ *
+ * @return true if the measurement converged
+ */
+bool BenchmarkController::hasConverged() const {
+    return this->converged;
+}
+
+const PerformanceMetric &BenchmarkController::getMeasured() const {
+    return this->measured;
+}
@@ -0,0 +1,288 @@
+/**
+* @file PerfCounters.cpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains hardware performance counters for the CPU force calculation (Linux perf_event_open)
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#include "../../include/PerformanceMetrics/PerfCounters.hpp"
+#include "../../include/PerformanceMetrics/Roofline.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+CounterValues &CounterValues::operator+=(const CounterValues &other) {
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Counter::COUNT); ++i) {
+        values[i] += other.values[i];
+        valid[i] = valid[i] || other.valid[i];
+    }
+    regions += other.regions;
+    threads = std::max(threads, other.threads);
+    return *this;
+}
+
+bool CounterValues::isValid(Counter counter) const {
+    return regions > 0 && valid[static_cast<std::size_t>(counter)];
+}
+
+double CounterValues::get(Counter counter) const {
+    return values[static_cast<std::size_t>(counter)];
+}
+
+/**
+ * @brief Instructions per cycle summed over all threads.
+ *
+ * @return double IPC or 0 if cycles or instructions could not be counted
+ */
+double CounterValues::getIpc() const {
+    if (!isValid(Counter::CYCLES) || !isValid(Counter::INSTRUCTIONS) || get(Counter::CYCLES) == 0.0)
+        return 0.0;
+    return get(Counter::INSTRUCTIONS) / get(Counter::CYCLES);
+}
+
+/**
+ * @brief Average number of events per body-body interaction of the measured force phases.
+ *
+ * @param counter the counter
+ * @param nbody number of bodies
+ * @return double events per interaction or 0 if the counter could not be counted
+ */
+double CounterValues::getPerInteraction(Counter counter, std::size_t nbody) const {
+    double interactions = getInteractionsPerStep(nbody) * static_cast<double>(regions);
+    if (!isValid(counter) || interactions == 0.0)
+        return 0.0;
+    return get(counter) / interactions;
+}
+
+namespace PerfCounters {
+    /**
+     * @brief An event of a counter group
+     */
+    struct EventSpec {
+        uint32_t type;
+        uint64_t config;
+        std::size_t group;
+        Counter counter;
+        double weight;//!< Factor applied before adding the event to its counter (number of FP lanes)
+    };
+
+    static bool enabled = false;
+    static std::vector<EventSpec> events;//!< Events which could be opened by enable() (all threads open the same)
+    static std::mutex totalsMutex;
+    static CounterValues totals;          //!< Sum over all threads since the last collect()
+    static std::size_t contributions = 0;//!< Number of scopes added to totals since the last collect()
+
+#ifdef __linux__
+    /**
+     * @brief Counter groups of a single thread; closed when the thread ends
+     */
+    struct ThreadCounters {
+        int leaders[maxGroups] = {-1, -1};
+        std::vector<int> fds;
+        bool opened = false;
+        bool failed = false;
+
+        ~ThreadCounters() {
+            for (int fd : fds)
+                close(fd);
+        }
+    };
+
+    static int openEvent(const EventSpec &spec, int groupFd) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = spec.type;
+        attr.config = spec.config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // counts the calling thread on any CPU
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+    }
+
+    /**
+     * @brief Opens the groups of the given events for the calling thread.
+     *
+     * @param specs events to open, ordered by group
+     * @param counters receives the file descriptors
+     * @param opened receives the events which could be opened (may be null if all events are required)
+     * @return int 0 or the errno of the first failing leader
+     */
+    static int openGroups(const std::vector<EventSpec> &specs, ThreadCounters &counters, std::vector<EventSpec> *opened) {
+        for (const EventSpec &spec : specs) {
+            int &leader = counters.leaders[spec.group];
+            int fd = openEvent(spec, leader);
+            if (fd < 0) {
+                if (spec.group == 0 && leader < 0)
+                    return errno;
+                if (opened == nullptr)
+                    return errno;
+                continue;// not supported by this CPU, the others are still counted
+            }
+            if (leader < 0)
+                leader = fd;
+            counters.fds.push_back(fd);
+            if (opened != nullptr)
+                opened->push_back(spec);
+        }
+        return 0;
+    }
+
+    static ThreadCounters &getThreadCounters() {
+        thread_local ThreadCounters counters;
+        if (!counters.opened) {
+            counters.opened = true;
+            counters.failed = openGroups(events, counters, nullptr) != 0;
+        }
+        return counters;
+    }
+
+    /**
+     * @brief Reads all groups of the calling thread.
+     *
+     * @param counters counter groups of the thread
+     * @param snapshot receives the values in the order of events
+     * @return true if all groups could be read
+     */
+    static bool readGroups(const ThreadCounters &counters, Snapshot &snapshot) {
+        std::size_t index = 0;
+        for (std::size_t group = 0; group < maxGroups; ++group) {
+            if (counters.leaders[group] < 0)
+                continue;
+            uint64_t buffer[3 + maxEvents];
+            if (read(counters.leaders[group], buffer, sizeof(buffer)) <= 0)
+                return false;
+            snapshot.timeEnabled[group] = buffer[1];
+            snapshot.timeRunning[group] = buffer[2];
+            for (uint64_t i = 0; i < buffer[0] && index < maxEvents; ++i)
+                snapshot.values[index++] = buffer[3 + i];
+        }
+        return true;
+    }
+
+    static bool isIntelCpu() {
+        std::ifstream cpuInfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuInfo, line)) {
+            if (line.rfind("vendor_id", 0) == 0)
+                return line.find("GenuineIntel") != std::string::npos;
+        }
+        return false;
+    }
+#endif
+
+    /**
+     * @brief Checks whether counters can be opened and enables counting.
+     *
+     * Cycles, instructions, cache misses and branch misses are generic perf events. FP operations have no generic
+     * event; they are counted with FP_ARITH_INST_RETIRED (Broadwell and later) on Intel CPUs only.
+     *
+     * @return true if at least the cycles could be counted
+     */
+    bool enable() {
+#ifdef __linux__
+        std::vector<EventSpec> candidates = {
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0, Counter::CYCLES, 1.0},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0, Counter::INSTRUCTIONS, 1.0},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 0, Counter::CACHE_MISSES, 1.0},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, 0, Counter::BRANCH_MISSES, 1.0}};
+        if (isIntelCpu()) {
+            // FP_ARITH_INST_RETIRED (event 0xC7) with the umasks of scalar, 128, 256 and 512 bit single precision
+            candidates.push_back({PERF_TYPE_RAW, 0x02C7, 1, Counter::FP_OPS, 1.0});
+            candidates.push_back({PERF_TYPE_RAW, 0x08C7, 1, Counter::FP_OPS, 4.0});
+            candidates.push_back({PERF_TYPE_RAW, 0x20C7, 1, Counter::FP_OPS, 8.0});
+            candidates.push_back({PERF_TYPE_RAW, 0x80C7, 1, Counter::FP_OPS, 16.0});
+        }
+        // the probe is closed again; every thread opens the events which are supported on first use
+        ThreadCounters probe;
+        std::vector<EventSpec> opened;
+        int error = openGroups(candidates, probe, &opened);
+        if (error != 0) {
+            std::cerr << "Hardware performance counters are not available (" << std::strerror(error)
+                      << "); check /proc/sys/kernel/perf_event_paranoid. Continuing without counters." << std::endl;
+            return false;
+        }
+        events = opened;
+        enabled = true;
+        return true;
+#else
+        std::cerr << "Hardware performance counters are only supported on Linux. Continuing without counters." << std::endl;
+        return false;
+#endif
+    }
+
+    bool isEnabled() {
+        return enabled;
+    }
+
+    /**
+     * @brief Returns the counters summed over all threads since the last call and resets them.
+     *
+     * Must be called after the measured parallel region has ended.
+     *
+     * @return CounterValues counters of one region (regions is 0 if nothing was counted)
+     */
+    CounterValues collect() {
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        CounterValues result = totals;
+        if (contributions > 0) {
+            result.regions = 1;
+            result.threads = contributions;
+        }
+        totals = CounterValues();
+        contributions = 0;
+        return result;
+    }
+}// namespace PerfCounters
+
+PerfCounterScope::PerfCounterScope() {
+#ifdef __linux__
+    if (!PerfCounters::enabled)
+        return;
+    PerfCounters::ThreadCounters &counters = PerfCounters::getThreadCounters();
+    active = !counters.failed && PerfCounters::readGroups(counters, start);
+#endif
+}
+
+PerfCounterScope::~PerfCounterScope() {
+#ifdef __linux__
+    if (!active)
+        return;
+    PerfCounters::Snapshot end;
+    if (!PerfCounters::readGroups(PerfCounters::getThreadCounters(), end))
+        return;
+    CounterValues delta;
+    for (std::size_t i = 0; i < PerfCounters::events.size(); ++i) {
+        const PerfCounters::EventSpec &spec = PerfCounters::events[i];
+        std::size_t group = spec.group;
+        uint64_t running = end.timeRunning[group] - start.timeRunning[group];
+        if (running == 0)
+            continue;// the group was never scheduled in this scope
+        // extrapolates if the groups had to share the hardware counters
+        double scale = static_cast<double>(end.timeEnabled[group] - start.timeEnabled[group]) / static_cast<double>(running);
+        std::size_t counter = static_cast<std::size_t>(spec.counter);
+        delta.values[counter] += static_cast<double>(end.values[i] - start.values[i]) * scale * spec.weight;
+        delta.valid[counter] = true;
+    }
+    std::lock_guard<std::mutex> lock(PerfCounters::totalsMutex);
+    PerfCounters::totals += delta;
+    ++PerfCounters::contributions;
+#endif
+}
@@ -10,25 +10,161 @@
 */
 #include "../../include/PerformanceMetrics/PerformanceMetric.hpp"
 #include <algorithm>
-#include <numeric>
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 PerformanceMetric::PerformanceMetric() = default;
 
+/**
+ * @brief Index of the most significant set bit of a value which is not 0
+ */
+static unsigned mostSignificantBit(const uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+/**
+ * @brief Maps a sample to its histogram bucket.
+ *
+ * Values below subBucketCount get an exact bucket each. Larger values keep their
+ * subBucketBits + 1 most significant bits, which selects one of subBucketCount linear
+ * sub-buckets within their power of two.
+ *
+ * @param nanoseconds the sample
+ * @return std::size_t index of the bucket
+ */
+std::size_t PerformanceMetric::getBucketIndex(const uint64_t nanoseconds) {
+    if (nanoseconds < subBucketCount)
+        return nanoseconds;
+    unsigned msb = mostSignificantBit(nanoseconds);
+    unsigned shift = msb - subBucketBits;
+    uint64_t subBucket = (nanoseconds >> shift) - subBucketCount;
+    return (shift + 1) * subBucketCount + subBucket;
+}
+
+/**
+ * @brief Returns the value in the middle of a histogram bucket.
+ *
+ * @param index index of the bucket
+ * @return double representative value of the bucket in seconds
+ */
+double PerformanceMetric::getBucketValue(const std::size_t index) {
+    if (index < subBucketCount)
+        return index * 1e-9;
+    unsigned shift = index / subBucketCount - 1;
+    uint64_t lower = (subBucketCount + index % subBucketCount) << shift;
+    uint64_t width = uint64_t(1) << shift;
+    return (lower + (width - 1) / 2.0) * 1e-9;
+}
+
 void PerformanceMetric::addTime(const double t) {
-    this->times.push_back(t);
+    this->count++;
+    double delta = t - this->mean;
+    this->mean += delta / this->count;
+    this->m2 += delta * (t - this->mean);
+    this->minTime = std::min(this->minTime, t);
+    this->maxTime = std::max(this->maxTime, t);
+
+    auto nanoseconds = static_cast<uint64_t>(std::llround(std::max(t, 0.0) * 1e9));
+    std::size_t index = getBucketIndex(nanoseconds);
+    if (index >= this->buckets.size())
+        this->buckets.resize(index + 1, 0);
+    this->buckets[index]++;
 }
 
 double PerformanceMetric::getMinTime() const {
-    auto minElement =  std::min_element(this->times.begin(), this->times.end());
-    return *minElement;
+    return this->minTime;
 }
 
 double PerformanceMetric::getMaxTime() const {
-    auto maxElement = std::max_element(this->times.begin(), this->times.end());
-    return *maxElement;
+    return this->maxTime;
 }
 
 double PerformanceMetric::getAvgTime() const {
-    auto const count = static_cast<float>(this->times.size());
-    return std::reduce(this->times.begin(), this->times.end()) / count;
+    return this->mean;
+}
+
+/**
+ * @brief Sample standard deviation of the measured times.
+ *
+ * @return double standard deviation in seconds (0 for less than two samples)
+ */
+double PerformanceMetric::getStdDev() const {
+    if (this->count < 2)
+        return 0.0;
+    return std::sqrt(this->m2 / (this->count - 1));
+}
+
+/**
+ * @brief Coefficient of variation, i.e. the standard deviation relative to the mean.
+ *
+ * @return double coefficient of variation (dimensionless)
+ */
+double PerformanceMetric::getCoefficientOfVariation() const {
+    if (this->mean == 0.0)
+        return 0.0;
+    return this->getStdDev() / this->mean;
+}
+
+/**
+ * @brief Two-sided 97.5 % quantile of Student's t-distribution.
+ *
+ * Tabulated up to 30 degrees of freedom, above a Cornish-Fisher expansion around the normal quantile is used.
+ *
+ * @param degreesOfFreedom degrees of freedom (at least 1)
+ * @return double quantile
+ */
+static double studentT975(const std::size_t degreesOfFreedom) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degreesOfFreedom <= 30)
+        return table[std::max<std::size_t>(degreesOfFreedom, 1) - 1];
+    const double z = 1.959964;
+    double v = static_cast<double>(degreesOfFreedom);
+    return z + (z * z * z + z) / (4 * v) + (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * v * v);
+}
+
+/**
+ * @brief Half width of the 95 % confidence interval of the mean (Student's t, samples assumed independent).
+ *
+ * @return double half width in seconds (infinite for less than two samples)
+ */
+double PerformanceMetric::getConfidenceHalfWidth() const {
+    if (this->count < 2)
+        return std::numeric_limits<double>::infinity();
+    return studentT975(this->count - 1) * this->getStdDev() / std::sqrt(static_cast<double>(this->count));
+}
+
+/**
+ * @brief Returns the smallest time which is greater than or equal to the given percentage of all samples.
+ *
+ * The result is accurate up to the bucket resolution and clamped to the exact minimum and maximum.
+ *
+ * @param percentile percentile in [0, 100], e.g. 99.9
+ * @return double time in seconds (0 if there are no samples)
+ */
+double PerformanceMetric::getPercentile(const double percentile) const {
+    if (this->count == 0)
+        return 0.0;
+    auto rank = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * this->count));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < this->buckets.size(); ++i) {
+        seen += this->buckets[i];
+        if (seen >= rank)
+            return std::clamp(getBucketValue(i), this->minTime, this->maxTime);
+    }
+    return this->maxTime;
+}
+
+std::size_t PerformanceMetric::getCount() const {
+    return this->count;
 }
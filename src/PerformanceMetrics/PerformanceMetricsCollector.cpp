@@ -17,13 +17,50 @@
 #include <sstream>
 
 #include "../../include/PerformanceMetrics/PerformanceMetricsCollector.hpp"
+#include "../../include/PerformanceMetrics/Roofline.hpp"
 
 extern bool useGPU;
 extern bool useCPU;
 extern std::string kernelFile;
 extern std::string gpuName;
+extern PeakPerformance peakPerformance;
 
-PerformanceMetricsCollector::PerformanceMetricsCollector() = default;
+PerformanceMetricsCollector::PerformanceMetricsCollector() : phaseTimes(static_cast<std::size_t>(Phase::COUNT)),
+                                                             phaseQueueDelays(static_cast<std::size_t>(Phase::COUNT)),
+                                                             phaseLaunchDelays(static_cast<std::size_t>(Phase::COUNT)) {}
+
+/**
+ * @brief Returns the name of a phase as used in the CSV header.
+ *
+ * @param phase the phase
+ * @return const char* name of the phase
+ */
+const char *PerformanceMetricsCollector::getPhaseName(Phase phase) {
+    static const char *names[] = {"gl_finish", "gl_acquire", "write_pos", "write_vel", "force_kernel", "update_kernel", "read_pos",
+                                  "gl_release", "cpu_force", "cpu_update", "vbo_upload", "validation", "diagnostics", "draw"};
+    return names[static_cast<std::size_t>(phase)];
+}
+
+/**
+ * @brief Whether a phase is measured with OpenCL profiling events (and therefore has queue and launch delays).
+ *
+ * @param phase the phase
+ * @return true if the phase is an OpenCL command
+ */
+bool PerformanceMetricsCollector::isDevicePhase(Phase phase) {
+    switch (phase) {
+        case Phase::GL_ACQUIRE:
+        case Phase::WRITE_POSITIONS:
+        case Phase::WRITE_VELOCITIES:
+        case Phase::FORCE_KERNEL:
+        case Phase::UPDATE_KERNEL:
+        case Phase::READ_POSITIONS:
+        case Phase::GL_RELEASE:
+            return true;
+        default:
+            return false;
+    }
+}
 
 /**
  * @brief Function to get the exact CPU model (works only on Linux).
@@ -49,16 +86,25 @@ std::string PerformanceMetricsCollector::getCPUModel() {
 }
 
 /**
- * @brief Writes system information and a header to a CSV file were the benchmark results can be saved in.
+ * @brief Formats the current local time so that it can be used in file names.
  *
- * @return std::string path to a CSV file were the benchmark results can be saved
+ * @return std::string current time as YYYY_MM_DD-hh-mm-ss
  */
-std::string PerformanceMetricsCollector::initLogFile() {
+std::string PerformanceMetricsCollector::getTimeStamp() {
     auto t = std::time(nullptr);
     auto tm = *std::localtime(&t);
     std::ostringstream oss;
     oss << std::put_time(&tm, "%Y_%m_%d-%H-%M-%S");
-    auto time = oss.str();
+    return oss.str();
+}
+
+/**
+ * @brief Writes system information and a header to a CSV file were the benchmark results can be saved in.
+ *
+ * @return std::string path to a CSV file were the benchmark results can be saved
+ */
+std::string PerformanceMetricsCollector::initLogFile() {
+    auto time = PerformanceMetricsCollector::getTimeStamp();
 
     std::string description;
 #ifdef __linux__
@@ -94,7 +140,20 @@ std::string PerformanceMetricsCollector::initLogFile() {
     std::ofstream logFile;
     logFile.open(fileName);
     logFile << description << std::endl;
-    logFile << "nbody,calc_min,calc_max,calc_avg,fps_min,fps_max,fps_avg" << std::endl;
+    logFile << "nbody,repetition,calc_min,calc_max,calc_avg,fps_min,fps_max,fps_avg";
+    logFile << ",calc_p50,calc_p90,calc_p99,calc_p999,calc_stddev,calc_cv";
+    logFile << ",frame_p50,frame_p90,frame_p99,frame_p999,frame_stddev,frame_cv";
+    logFile << ",calc_ci95_low,calc_ci95_high,calc_ci95_rel,samples,warmup_steps,converged";
+    logFile << ",interactions_per_s,gflops,bandwidth_gbs,peak_gflops,peak_bandwidth_gbs,peak_gflops_pct,peak_bandwidth_pct";
+    logFile << ",ipc,cache_misses_per_interaction,branch_misses_per_interaction,fp_ops_per_interaction,counter_threads";
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Phase::COUNT); ++i) {
+        Phase phase = static_cast<Phase>(i);
+        logFile << "," << getPhaseName(phase) << "_avg";
+        if (isDevicePhase(phase)) {
+            logFile << "," << getPhaseName(phase) << "_queue_avg," << getPhaseName(phase) << "_launch_avg";
+        }
+    }
+    logFile << std::endl;
     logFile.close();
     return fileName;
 }
@@ -117,11 +176,118 @@ void PerformanceMetricsCollector::addCalcTime(double t) {
 }
 
 /**
- * @brief This method is used to print the current average calculation time and frame rate (only used in non-benchmark mode).
+ * @brief Saves how the benchmark run ended, so that it can be written to the CSV file.
+ *
+ * @param warmUpSteps number of steps before the measurement started
+ * @param converged whether the confidence interval reached its target width before the time budget ran out
+ */
+void PerformanceMetricsCollector::setBenchmarkStatus(std::size_t warmUpSteps, bool converged) {
+    this->warmUpSteps = warmUpSteps;
+    this->converged = converged;
+}
+
+/**
+ * @brief Saves the duration of a phase which has been measured with a host timer.
+ *
+ * @param phase the measured phase
+ * @param t duration in seconds
  */
-void PerformanceMetricsCollector::printResult() {
-    std::cout << "Avg calc time: " << calcTimes.getAvgTime() << "s, ";
-    std::cout << "Avg FPS: " << 1.0 / renderTimes.getAvgTime() << std::endl;
+void PerformanceMetricsCollector::addPhaseTime(Phase phase, double t) {
+    phaseTimes[static_cast<std::size_t>(phase)].addTime(t);
+}
+
+/**
+ * @brief Saves the profiling timestamps of an OpenCL command.
+ *
+ * @param phase the measured phase
+ * @param queued CL_PROFILING_COMMAND_QUEUED in nanoseconds
+ * @param submit CL_PROFILING_COMMAND_SUBMIT in nanoseconds
+ * @param start CL_PROFILING_COMMAND_START in nanoseconds
+ * @param end CL_PROFILING_COMMAND_END in nanoseconds
+ */
+void PerformanceMetricsCollector::addPhaseEvent(Phase phase, uint64_t queued, uint64_t submit, uint64_t start, uint64_t end) {
+    std::size_t index = static_cast<std::size_t>(phase);
+    phaseTimes[index].addTime((end - start) * 1e-9);
+    phaseQueueDelays[index].addTime((submit - queued) * 1e-9);
+    phaseLaunchDelays[index].addTime((start - submit) * 1e-9);
+}
+
+/**
+ * @brief Adds the hardware counters of a CPU force phase.
+ *
+ * @param values counters summed over all threads of the phase
+ */
+void PerformanceMetricsCollector::addCounters(const CounterValues &values) {
+    counters += values;
+}
+
+/**
+ * @brief This method is used to print the current average calculation time, frame rate and throughput (only used in non-benchmark mode).
+ *
+ * @param nbody number of bodies that are simulated
+ */
+void PerformanceMetricsCollector::printResult(const size_t nbody) {
+    std::cout << "Avg calc time: " << calcTimes.getAvgTime() << "s ";
+    std::cout << "(p50 " << calcTimes.getPercentile(50) << "s, p99 " << calcTimes.getPercentile(99)
+              << "s, p99.9 " << calcTimes.getPercentile(99.9) << "s, CV " << calcTimes.getCoefficientOfVariation() << "), ";
+    std::cout << "Avg FPS: " << 1.0 / renderTimes.getAvgTime() << " ";
+    std::cout << "(p99 frame time " << renderTimes.getPercentile(99) << "s, p99.9 " << renderTimes.getPercentile(99.9)
+              << "s, CV " << renderTimes.getCoefficientOfVariation() << ")" << std::endl;
+    std::cout << "Throughput: " << getInteractionsPerSecond(nbody) << " interactions/s, " << getGflops(nbody) << " GFLOP/s";
+    // without --MeasurePeak the peak is not measured in interactive mode
+    if (peakPerformance.gflops > 0.0)
+        std::cout << " (" << 100.0 * getGflops(nbody) / peakPerformance.gflops << "% of peak)";
+    std::cout << ", " << getBandwidth(nbody) << " GB/s";
+    if (peakPerformance.bandwidth > 0.0)
+        std::cout << " (" << 100.0 * getBandwidth(nbody) / peakPerformance.bandwidth << "% of peak)";
+    std::cout << std::endl;
+    if (counters.regions > 0) {
+        std::cout << "Counters (" << counters.threads << " threads): IPC " << counters.getIpc() << ", per interaction: "
+                  << counters.getPerInteraction(Counter::CACHE_MISSES, nbody) << " cache misses, "
+                  << counters.getPerInteraction(Counter::BRANCH_MISSES, nbody) << " branch misses, "
+                  << counters.getPerInteraction(Counter::FP_OPS, nbody) << " FP ops" << std::endl;
+    }
+}
+
+/**
+ * @brief Body-body interactions per second based on the average calculation time of a step.
+ *
+ * @param nbody number of bodies
+ * @return double interactions per second
+ */
+double PerformanceMetricsCollector::getInteractionsPerSecond(const size_t nbody) const {
+    return getInteractionsPerStep(nbody) / calcTimes.getAvgTime();
+}
+
+/**
+ * @brief Effective GFLOP/s based on a fixed number of flops per interaction.
+ *
+ * @param nbody number of bodies
+ * @return double GFLOP/s
+ */
+double PerformanceMetricsCollector::getGflops(const size_t nbody) const {
+    return getInteractionsPerSecond(nbody) * flopsPerInteraction * 1e-9;
+}
+
+/**
+ * @brief Achieved memory bandwidth based on the minimal memory traffic of a step.
+ *
+ * @param nbody number of bodies
+ * @return double GB/s
+ */
+double PerformanceMetricsCollector::getBandwidth(const size_t nbody) const {
+    return getBytesPerStep(nbody) / calcTimes.getAvgTime() * 1e-9;
+}
+
+/**
+ * @brief Appends the percentiles, standard deviation and coefficient of variation of a metric to a CSV line.
+ *
+ * @param logFile opened CSV file
+ * @param metric the metric to write
+ */
+void PerformanceMetricsCollector::writeDistribution(std::ostream &logFile, const PerformanceMetric &metric) {
+    logFile << "," << metric.getPercentile(50) << "," << metric.getPercentile(90) << "," << metric.getPercentile(99)
+            << "," << metric.getPercentile(99.9) << "," << metric.getStdDev() << "," << metric.getCoefficientOfVariation();
 }
 
 /**
@@ -129,16 +295,56 @@ void PerformanceMetricsCollector::printResult() {
  *
  * @param logFileName path to the CSV file were the benchmark results can be saved
  * @param nbody number of bodies used in the benchmark step
+ * @param repetition index of the run with this number of bodies
  */
-void PerformanceMetricsCollector::writeToLogFile(const std::string &logFileName, const size_t nbody) const {
+void PerformanceMetricsCollector::writeToLogFile(const std::string &logFileName, const size_t nbody, const size_t repetition) const {
     std::ofstream logFile;
     logFile.open(logFileName, std::ios_base::app);
-    logFile << nbody << ",";
+    logFile << nbody << "," << repetition << ",";
     logFile << calcTimes.getMinTime() << "," << calcTimes.getMaxTime() << "," << calcTimes.getAvgTime() << ",";
-    logFile << 1.0 / renderTimes.getMaxTime() << "," << 1.0 / renderTimes.getMinTime() << "," << 1.0 / renderTimes.getAvgTime() << std::endl;
+    logFile << 1.0 / renderTimes.getMaxTime() << "," << 1.0 / renderTimes.getMinTime() << "," << 1.0 / renderTimes.getAvgTime();
+    writeDistribution(logFile, calcTimes);
+    writeDistribution(logFile, renderTimes);
+    double halfWidth = calcTimes.getConfidenceHalfWidth();
+    logFile << "," << calcTimes.getAvgTime() - halfWidth << "," << calcTimes.getAvgTime() + halfWidth << "," << halfWidth / calcTimes.getAvgTime();
+    logFile << "," << calcTimes.getCount() << "," << warmUpSteps << "," << converged;
+    logFile << "," << getInteractionsPerSecond(nbody) << "," << getGflops(nbody) << "," << getBandwidth(nbody);
+    logFile << "," << peakPerformance.gflops << "," << peakPerformance.bandwidth;
+    logFile << "," << 100.0 * getGflops(nbody) / peakPerformance.gflops << "," << 100.0 * getBandwidth(nbody) / peakPerformance.bandwidth;
+    // counters which are not available are left empty
+    logFile << ",";
+    if (counters.isValid(Counter::CYCLES) && counters.isValid(Counter::INSTRUCTIONS))
+        logFile << counters.getIpc();
+    for (Counter counter : {Counter::CACHE_MISSES, Counter::BRANCH_MISSES, Counter::FP_OPS}) {
+        logFile << ",";
+        if (counters.isValid(counter))
+            logFile << counters.getPerInteraction(counter, nbody);
+    }
+    logFile << ",";
+    if (counters.regions > 0)
+        logFile << counters.threads;
+    // phases which don't occur in the current mode are left empty
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Phase::COUNT); ++i) {
+        logFile << ",";
+        if (phaseTimes[i].getCount() > 0)
+            logFile << phaseTimes[i].getAvgTime();
+        if (isDevicePhase(static_cast<Phase>(i))) {
+            logFile << ",";
+            if (phaseQueueDelays[i].getCount() > 0)
+                logFile << phaseQueueDelays[i].getAvgTime();
+            logFile << ",";
+            if (phaseLaunchDelays[i].getCount() > 0)
+                logFile << phaseLaunchDelays[i].getAvgTime();
+        }
+    }
+    logFile << std::endl;
     logFile.close();
 }
 
-PerformanceMetric PerformanceMetricsCollector::getCalcTimes() const {
+const PerformanceMetric &PerformanceMetricsCollector::getCalcTimes() const {
     return this->calcTimes;
 }
+
+const CounterValues &PerformanceMetricsCollector::getCounters() const {
+    return this->counters;
+}
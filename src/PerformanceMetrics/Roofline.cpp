@@ -0,0 +1,126 @@
+/**
+* @file Roofline.cpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains the work model of a simulation step and microbenchmarks for the peak performance of the host
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#include "../../include/PerformanceMetrics/Roofline.hpp"
+#include "../../lib/Core/Time.hpp"
+
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * @brief Number of body-body interactions evaluated in one simulation step.
+ *
+ * @param nbody number of bodies
+ * @return double interactions per step
+ */
+double getInteractionsPerStep(std::size_t nbody) {
+    auto n = static_cast<double>(nbody);
+    return n * (n - 1.0);
+}
+
+/**
+ * @brief Minimal memory traffic of one simulation step.
+ *
+ * Assumes that positions and masses are read once by the force calculation (every further access hits a cache
+ * or local memory), the velocities are read and written by the force calculation and the positions are read
+ * and written by the update. A body has three floats per vector and one float mass.
+ *
+ * @param nbody number of bodies
+ * @return double bytes per step
+ */
+double getBytesPerStep(std::size_t nbody) {
+    const double vectorBytes = 3 * sizeof(float);
+    const double forceBytes = vectorBytes + sizeof(float) + 2 * vectorBytes;
+    const double updateBytes = 2 * vectorBytes + vectorBytes;
+    return static_cast<double>(nbody) * (forceBytes + updateBytes);
+}
+
+/**
+ * @brief Runs independent multiply-add chains on all OpenMP threads.
+ *
+ * The number of iterations is doubled until the measurement takes at least 50 ms.
+ *
+ * @return double attained GFLOP/s
+ */
+static double measureHostFlops() {
+    const int chains = 32;
+    std::size_t iterations = 1 << 16;
+    while (true) {
+        float checksum = 0.0f;
+        Core::TimeSpan start = Core::getCurrentTime();
+        int threads = 1;
+#pragma omp parallel reduction(+ : checksum)
+        {
+#ifdef _OPENMP
+#pragma omp single
+            threads = omp_get_num_threads();
+#endif
+            float acc[chains];
+            for (int c = 0; c < chains; ++c)
+                acc[c] = static_cast<float>(c);
+            for (std::size_t i = 0; i < iterations; ++i) {
+                for (int c = 0; c < chains; ++c)
+                    acc[c] = acc[c] * 0.999f + 0.001f;
+            }
+            for (int c = 0; c < chains; ++c)
+                checksum += acc[c];
+        }
+        double seconds = (Core::getCurrentTime() - start).getSeconds();
+        // the checksum keeps the compiler from removing the loop
+        if (seconds >= 0.05 && checksum != 0.0f)
+            return 2.0 * chains * iterations * threads / seconds * 1e-9;
+        iterations *= 2;
+    }
+}
+
+/**
+ * @brief Measures the memory bandwidth with a parallel stream triad (best of five passes).
+ *
+ * @return double attained GB/s (write-allocate traffic is not counted)
+ */
+static double measureHostBandwidth() {
+    const std::size_t n = std::size_t(1) << 23;// 3 * 32 MiB, far beyond the last level cache
+    std::vector<float> a(n), b(n), c(n);
+    // first touch in parallel so that the pages are spread over NUMA nodes like the data set
+#pragma omp parallel for
+    for (std::size_t i = 0; i < n; ++i) {
+        a[i] = 0.0f;
+        b[i] = 1.0f;
+        c[i] = 2.0f;
+    }
+    double best = 0.0;
+    for (int pass = 0; pass < 5; ++pass) {
+        Core::TimeSpan start = Core::getCurrentTime();
+#pragma omp parallel for
+        for (std::size_t i = 0; i < n; ++i) {
+            a[i] = b[i] + 0.5f * c[i];
+        }
+        double seconds = (Core::getCurrentTime() - start).getSeconds();
+        best = std::max(best, 3.0 * n * sizeof(float) / seconds * 1e-9);
+    }
+    return best;
+}
+
+/**
+ * @brief Measures the attained peak performance of the host CPU.
+ *
+ * @return PeakPerformance GFLOP/s and GB/s of the host
+ */
+PeakPerformance measureHostPeak() {
+    PeakPerformance peak;
+    peak.gflops = measureHostFlops();
+    peak.bandwidth = measureHostBandwidth();
+    peak.source = "host";
+    return peak;
+}
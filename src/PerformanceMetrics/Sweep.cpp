@@ -0,0 +1,81 @@
+/**
+* @file Sweep.cpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a parser for the body counts of a benchmark sweep
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#include "../../include/PerformanceMetrics/Sweep.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief Parses a positive number and throws if the whole string is not a number.
+ *
+ * @param text the number as a string
+ * @param sweep the complete sweep (only used for the error message)
+ * @return double the parsed number
+ */
+static double parsePositive(const std::string &text, const std::string &sweep) {
+    std::size_t parsed = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(text, &parsed);
+    } catch (const std::exception &) {
+        parsed = 0;
+    }
+    if (parsed == 0 || parsed != text.size() || !(value > 0.0))
+        throw std::invalid_argument("Invalid sweep '" + sweep + "': '" + text + "' is no positive number");
+    return value;
+}
+
+/**
+ * @brief Expands a sweep description into a list of body counts.
+ *
+ * Supported forms are "first:last:xF" (geometric, every count is F times the previous one),
+ * "first:last:+S" (arithmetic with step S) and a comma separated list like "1000,5000,20000".
+ * Counts beyond the last one are not included.
+ *
+ * @param sweep the sweep description
+ * @return std::vector<std::size_t> ascending body counts without duplicates
+ */
+std::vector<std::size_t> parseSweep(const std::string &sweep) {
+    std::vector<std::size_t> bodyCounts;
+    if (sweep.find(':') == std::string::npos) {
+        std::stringstream list(sweep);
+        std::string entry;
+        while (std::getline(list, entry, ','))
+            bodyCounts.push_back(static_cast<std::size_t>(std::llround(parsePositive(entry, sweep))));
+    } else {
+        std::stringstream range(sweep);
+        std::string first, last, step;
+        if (!std::getline(range, first, ':') || !std::getline(range, last, ':') || !std::getline(range, step) || step.size() < 2)
+            throw std::invalid_argument("Invalid sweep '" + sweep + "': expected first:last:xF or first:last:+S");
+        double current = parsePositive(first, sweep);
+        double end = parsePositive(last, sweep);
+        double increment = parsePositive(step.substr(1), sweep);
+        if (step[0] == 'x') {
+            if (increment <= 1.0)
+                throw std::invalid_argument("Invalid sweep '" + sweep + "': the factor must be greater than 1");
+            for (; current <= end * (1.0 + 1e-9); current *= increment)
+                bodyCounts.push_back(static_cast<std::size_t>(std::llround(current)));
+        } else if (step[0] == '+') {
+            for (; current <= end * (1.0 + 1e-9); current += increment)
+                bodyCounts.push_back(static_cast<std::size_t>(std::llround(current)));
+        } else {
+            throw std::invalid_argument("Invalid sweep '" + sweep + "': the step must start with 'x' or '+'");
+        }
+    }
+    if (bodyCounts.empty())
+        throw std::invalid_argument("Invalid sweep '" + sweep + "': no body counts");
+    std::sort(bodyCounts.begin(), bodyCounts.end());
+    bodyCounts.erase(std::unique(bodyCounts.begin(), bodyCounts.end()), bodyCounts.end());
+    return bodyCounts;
+}
@@ -0,0 +1,176 @@
+/**
+* @file Trace.cpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a scoped-zone profiler which writes a timeline in the Chrome trace-event format
+* @version 1
+* @date 2022-01-17
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#include "../../include/PerformanceMetrics/Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+    /**
+     * @brief One complete zone ("ph":"X" in the trace-event format)
+     */
+    struct Event {
+        const char *name;
+        const char *category;
+        int64_t start;//!< host time in microseconds
+        int64_t end;  //!< host time in microseconds
+    };
+
+    /**
+     * @brief Ring buffer of a single thread.
+     *
+     * Only the owning thread writes; the writer of the trace file reads after publishing has been acquired from head.
+     * If the buffer overflows, the oldest events are overwritten.
+     */
+    struct ThreadBuffer {
+        static const std::size_t capacity = std::size_t(1) << 16;
+        std::vector<Event> events;//!< Allocated when tracing is enabled
+        std::atomic<std::size_t> head{0};//!< Number of events written so far
+        int threadId = 0;
+
+        void push(const Event &event) {
+            std::size_t index = head.load(std::memory_order_relaxed);
+            events[index % capacity] = event;
+            head.store(index + 1, std::memory_order_release);
+        }
+    };
+
+    const int deviceThreadId = 1000;//!< Track of the OpenCL queue
+
+    static bool enabled = false;
+    static int64_t traceStart = 0;
+    static std::atomic<int64_t> deviceClockOffset{0};
+    static std::mutex registryMutex;                          //!< Only taken when a thread records its first event
+    static std::vector<std::unique_ptr<ThreadBuffer>> buffers;//!< Buffers of all threads (kept until the end of the program)
+    static ThreadBuffer deviceBuffer;                          //!< Buffer of the OpenCL queue (only written by the thread enqueueing the commands)
+
+    /**
+     * @brief Returns the buffer of the calling thread and registers it on first use.
+     */
+    static ThreadBuffer &getThreadBuffer() {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->events.resize(ThreadBuffer::capacity);
+            buffer->threadId = static_cast<int>(buffers.size());
+        }
+        return *buffer;
+    }
+
+    /**
+     * @brief Starts recording; must be called before the first zone.
+     */
+    void enable() {
+        enabled = true;
+        traceStart = Core::getCurrentTime().getMicroseconds();
+        deviceBuffer.events.resize(ThreadBuffer::capacity);
+        deviceBuffer.threadId = deviceThreadId;
+    }
+
+    bool isEnabled() {
+        return enabled;
+    }
+
+    /**
+     * @brief Records a zone of the calling thread.
+     *
+     * @param name name of the zone
+     * @param category category shown in the trace viewer
+     * @param start begin in microseconds (host clock)
+     * @param end end in microseconds (host clock)
+     */
+    void addZone(const char *name, const char *category, int64_t start, int64_t end) {
+        if (enabled)
+            getThreadBuffer().push(Event{name, category, start, end});
+    }
+
+    /**
+     * @brief Sets the offset between the OpenCL device clock and the host clock.
+     *
+     * @param offset host time in microseconds minus device time in microseconds
+     */
+    void setDeviceClockOffset(int64_t offset) {
+        deviceClockOffset.store(offset, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records an OpenCL command on the track of the queue.
+     *
+     * @param name name of the command
+     * @param startNs CL_PROFILING_COMMAND_START in nanoseconds
+     * @param endNs CL_PROFILING_COMMAND_END in nanoseconds
+     */
+    void addDeviceZone(const char *name, uint64_t startNs, uint64_t endNs) {
+        if (!enabled)
+            return;
+        int64_t offset = deviceClockOffset.load(std::memory_order_relaxed);
+        deviceBuffer.push(Event{name, "opencl", static_cast<int64_t>(startNs / 1000) + offset, static_cast<int64_t>(endNs / 1000) + offset});
+    }
+
+    /**
+     * @brief Appends the events of a buffer to the trace file.
+     */
+    static void writeEvents(std::ofstream &file, const ThreadBuffer &buffer, bool &first) {
+        std::size_t head = buffer.head.load(std::memory_order_acquire);
+        std::size_t begin = head > ThreadBuffer::capacity ? head - ThreadBuffer::capacity : 0;
+        for (std::size_t i = begin; i < head; ++i) {
+            const Event &event = buffer.events[i % ThreadBuffer::capacity];
+            file << (first ? "\n" : ",\n");
+            file << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.threadId
+                 << ",\"ts\":" << event.start - traceStart << ",\"dur\":" << std::max<int64_t>(event.end - event.start, 0) << "}";
+            first = false;
+        }
+    }
+
+    /**
+     * @brief Writes all recorded events to a JSON file in the Chrome trace-event format.
+     *
+     * Should be called when no other thread is recording anymore.
+     *
+     * @param fileName path of the trace file
+     */
+    void writeTraceFile(const std::string &fileName) {
+        if (!enabled)
+            return;
+        std::ofstream file(fileName);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto &buffer : buffers) {
+            file << (first ? "\n" : ",\n");
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":\"Thread " << buffer->threadId << "\"}}";
+            first = false;
+            writeEvents(file, *buffer, first);
+        }
+        file << (first ? "\n" : ",\n");
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << deviceThreadId << ",\"args\":{\"name\":\"OpenCL queue\"}}";
+        first = false;
+        writeEvents(file, deviceBuffer, first);
+        file << "\n]}\n";
+    }
+}// namespace Trace
+
+TraceZone::TraceZone(const char *name, const char *category) : name(name), category(category) {
+    if (Trace::isEnabled())
+        this->start = Core::getCurrentTime().getMicroseconds();
+}
+
+TraceZone::~TraceZone() {
+    if (Trace::isEnabled())
+        Trace::addZone(this->name, this->category, this->start, Core::getCurrentTime().getMicroseconds());
+}
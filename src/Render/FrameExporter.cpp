@@ -0,0 +1,190 @@
+/**
+ * @file FrameExporter.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains an exporter which reads rendered frames back asynchronously and writes them as image sequence
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Render/FrameExporter.hpp"
+#include "../../lib/Core/Image.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+
+/**
+ * @brief Stream buffer which writes to a C file handle, so that Core::writeImagePPM() can write into a pipe
+ */
+class FileStreamBuffer : public std::streambuf {
+private:
+    FILE *file;
+
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        return std::fputc(c, file) == EOF ? traits_type::eof() : c;
+    }
+
+    std::streamsize xsputn(const char *data, std::streamsize count) override {
+        return static_cast<std::streamsize>(std::fwrite(data, 1, count, file));
+    }
+
+public:
+    explicit FileStreamBuffer(FILE *file) : file(file) {
+    }
+};
+
+/**
+ * @brief Creates the pixel buffers and starts the writer thread
+ *
+ * @param target prefix of the numbered files (prefix000000.ppm, ...) or '|' followed by an encoder command, which
+ * receives all frames as a stream of PPM images on its standard input
+ * @param width width of the frames in pixels
+ * @param height height of the frames in pixels
+ * @param bufferCount number of frames which can wait for the writer thread
+ */
+FrameExporter::FrameExporter(const std::string &target, unsigned width, unsigned height, std::size_t bufferCount)
+    : width(width), height(height), frames(bufferCount), filledFrames(bufferCount), freeFrames(bufferCount) {
+    if (!target.empty() && target[0] == '|') {
+#ifdef _WIN32
+        encoder = _popen(target.c_str() + 1, "wb");
+#else
+        // an encoder which exits early must not kill the simulation; the failed write is reported instead
+        std::signal(SIGPIPE, SIG_IGN);
+        encoder = popen(target.c_str() + 1, "w");
+#endif
+        if (encoder == nullptr)
+            throw std::runtime_error("Can't start the encoder " + target.substr(1));
+    } else {
+        prefix = target;
+    }
+
+    const std::size_t frameBytes = 3 * static_cast<std::size_t>(width) * height;
+    glCreateBuffers(readbackDepth, pixelBuffers);
+    for (GLuint buffer : pixelBuffers) {
+        glNamedBufferStorage(buffer, frameBytes, nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+    }
+    for (Frame &frame : frames) {
+        frame.pixels.resize(frameBytes);
+        freeFrames.push(&frame);
+    }
+    writer = std::thread(&FrameExporter::writeLoop, this);
+}
+
+/**
+ * @brief Writes the frames whose readback is still pending and waits for the writer thread
+ */
+FrameExporter::~FrameExporter() {
+    for (unsigned i = 0; i < readbackDepth; ++i) {
+        unsigned buffer = (nextBuffer + i) % readbackDepth;
+        if (readbackFences[buffer] != nullptr)
+            collect(buffer);
+    }
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    glDeleteBuffers(readbackDepth, pixelBuffers);
+
+    if (encoder != nullptr) {
+#ifdef _WIN32
+        int status = _pclose(encoder);
+#else
+        int status = pclose(encoder);
+#endif
+        if (status != 0)
+            std::cerr << "The encoder exited with status " << status << std::endl;
+    }
+    if (failed.load())
+        std::cerr << "The frames could not be exported completely" << std::endl;
+    std::cout << "Exported " << capturedFrames << " frames" << std::endl;
+}
+
+/**
+ * @brief Starts reading back the current frame of the default framebuffer
+ *
+ * Has to be called after all draw calls of the frame and before the buffers are swapped. The buffer used for this
+ * frame is collected first; it has been read back readbackDepth frames ago, so its fence is normally signaled already.
+ */
+void FrameExporter::capture() {
+    unsigned buffer = nextBuffer;
+    if (readbackFences[buffer] != nullptr)
+        collect(buffer);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[buffer]);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readbackFences[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readbackNumbers[buffer] = capturedFrames++;
+    nextBuffer = (buffer + 1) % readbackDepth;
+}
+
+/**
+ * @brief Copies a finished readback into a free frame and hands it to the writer
+ *
+ * OpenGL stores the rows from bottom to top, so they are flipped while copying.
+ */
+void FrameExporter::collect(unsigned buffer) {
+    while (glClientWaitSync(readbackFences[buffer], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(readbackFences[buffer]);
+    readbackFences[buffer] = nullptr;
+
+    Frame *frame = nullptr;
+    while (!freeFrames.pop(frame)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    const std::size_t rowBytes = 3 * static_cast<std::size_t>(width);
+    const uint8_t *pixels = static_cast<const uint8_t *>(glMapNamedBufferRange(pixelBuffers[buffer], 0, rowBytes * height, GL_MAP_READ_BIT));
+    if (pixels != nullptr) {
+        for (unsigned row = 0; row < height; ++row) {
+            std::memcpy(frame->pixels.data() + row * rowBytes, pixels + (height - 1 - row) * rowBytes, rowBytes);
+        }
+        glUnmapNamedBuffer(pixelBuffers[buffer]);
+    }
+    frame->number = readbackNumbers[buffer];
+    // can't fail, the queue holds all buffers
+    filledFrames.push(frame);
+}
+
+void FrameExporter::writeLoop() {
+    FileStreamBuffer encoderBuffer(encoder);
+    std::ostream encoderStream(&encoderBuffer);
+    while (true) {
+        Frame *frame = nullptr;
+        if (filledFrames.pop(frame)) {
+            if (!failed.load(std::memory_order_relaxed)) {
+                try {
+                    if (encoder != nullptr) {
+                        Core::writeImagePPM(encoderStream, frame->pixels.data(), width, height);
+                        if (!encoderStream || std::fflush(encoder) != 0)
+                            throw std::runtime_error("The encoder doesn't accept more frames");
+                    } else {
+                        char number[32];
+                        std::snprintf(number, sizeof(number), "%06llu", static_cast<unsigned long long>(frame->number));
+                        Core::writeImagePPM(prefix + number + ".ppm", frame->pixels.data(), width, height);
+                    }
+                } catch (const std::exception &e) {
+                    // e.g. disk full; the frames are still recycled so that the render loop is not affected
+                    std::cerr << e.what() << std::endl;
+                    failed.store(true);
+                }
+            }
+            freeFrames.push(frame);
+        } else if (stopping.load(std::memory_order_acquire)) {
+            // capture() is not called anymore, so an empty queue means everything has been written
+            if (filledFrames.empty())
+                break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file Offscreen.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains the creation of an OpenGL context without window for nodes without X server
+ * @version 1
+ * @date 2022-01-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "../../include/Render/Offscreen.hpp"
+
+#include <iostream>
+
+#ifdef NBODY_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLSurface surface = EGL_NO_SURFACE;
+static EGLContext context = EGL_NO_CONTEXT;
+
+/**
+ * @brief Opens the first EGL display which can be initialized
+ *
+ * Without X server the GPUs are only reachable as EGL devices (EGL_EXT_platform_device), which Mesa offers for its
+ * software renderer llvmpipe as well. The default display is the fallback for implementations without devices.
+ */
+static EGLDisplay openDisplay() {
+    auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (queryDevices != nullptr && getPlatformDisplay != nullptr) {
+        EGLDeviceEXT devices[16];
+        EGLint count = 0;
+        if (queryDevices(16, devices, &count)) {
+            for (EGLint i = 0; i < count; ++i) {
+                EGLDisplay candidate = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], nullptr);
+                if (candidate != EGL_NO_DISPLAY && eglInitialize(candidate, nullptr, nullptr))
+                    return candidate;
+            }
+        }
+    }
+    EGLDisplay candidate = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (candidate != EGL_NO_DISPLAY && eglInitialize(candidate, nullptr, nullptr))
+        return candidate;
+    return EGL_NO_DISPLAY;
+}
+
+/**
+ * @brief Makes an OpenGL context with a pbuffer of the given size current instead of a GLUT window
+ *
+ * Like the GLUT window, the context doesn't request a version, so the implementation returns its newest
+ * compatibility context.
+ *
+ * @return false if EGL can't provide such a context (an error has been printed then)
+ */
+bool createOffscreenContext(unsigned width, unsigned height) {
+    display = openDisplay();
+    if (display == EGL_NO_DISPLAY) {
+        std::cerr << "No EGL display could be initialized" << std::endl;
+        return false;
+    }
+    const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_DEPTH_SIZE, 24,
+            EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "The EGL display has no RGBA pbuffer configuration for OpenGL" << std::endl;
+        destroyOffscreenContext();
+        return false;
+    }
+    const EGLint surfaceAttributes[] = {
+            EGL_WIDTH, static_cast<EGLint>(width),
+            EGL_HEIGHT, static_cast<EGLint>(height),
+            EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (surface == EGL_NO_SURFACE || !eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "Can't create an EGL pbuffer of " << width << "x" << height << " pixels" << std::endl;
+        destroyOffscreenContext();
+        return false;
+    }
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+        std::cerr << "Can't create an OpenGL context with EGL (error " << eglGetError() << ")" << std::endl;
+        destroyOffscreenContext();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Releases the context, the pbuffer and the display of createOffscreenContext()
+ */
+void destroyOffscreenContext() {
+    if (display == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT)
+        eglDestroyContext(display, context);
+    if (surface != EGL_NO_SURFACE)
+        eglDestroySurface(display, surface);
+    eglTerminate(display);
+    context = EGL_NO_CONTEXT;
+    surface = EGL_NO_SURFACE;
+    display = EGL_NO_DISPLAY;
+}
+#else
+bool createOffscreenContext(unsigned width, unsigned height) {
+    std::cerr << "Offscreen rendering needs EGL, which was not found when this program was built" << std::endl;
+    return false;
+}
+
+void destroyOffscreenContext() {
+}
+#endif
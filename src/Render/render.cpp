@@ -25,7 +25,11 @@ typedef unsigned int uint;
 #include "./Simulation/CPUCalc.hpp"
 #include "./Simulation/GPUCalc.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <iostream>
+#include <thread>
 
 //cl imports
 #include <../../lib/OpenCL/Device.hpp>
@@ -33,8 +37,11 @@ typedef unsigned int uint;
 #include <../../lib/OpenCL/Program.hpp>
 #include <../../lib/OpenCL/cl-patched.hpp>
 
+#include "../../include/Render/FrameExporter.hpp"
+#include "../../include/Render/Offscreen.hpp"
 #include "../../include/Render/render.hpp"
 #include "../../include/Simulation/CompareResults.hpp"
+#include "../../include/Simulation/Diagnostics.hpp"
 #include "../../include/callbacks.hpp"
 #include "../../include/constants.hpp"
 #include "../../include/glm/gtc/matrix_transform.hpp"
@@ -43,8 +50,13 @@ typedef unsigned int uint;
 #include "../../lib/Core/Time.hpp"
 #include "../../include/PerformanceMetrics/PerformanceMetric.hpp"
 
+#include "../../include/Data/Snapshot.hpp"
+#include "../../include/Data/TrajectoryRecorder.hpp"
+#include "../../include/Data/TripleBuffer.hpp"
 #include "../../include/Data/WikipediaDataSet.hpp"
+#include "../../include/PerformanceMetrics/BenchmarkController.hpp"
 #include "../../include/PerformanceMetrics/PerformanceMetricsCollector.hpp"
+#include "../../include/PerformanceMetrics/Trace.hpp"
 
 bool initialRun = true;//!< Determines whether the render loop is being executed for the first time
 
@@ -52,9 +64,28 @@ extern bool useGPU;
 extern bool useCPU;
 
 GLuint vbo;
+float *mappedPositions = nullptr;//!< Persistently mapped storage of vbo (only used if the CPU calculates the rendered positions)
+GLsync positionsFence = nullptr; //!< Signals that the draw call reading vbo has been finished
+GLuint positionRing[3] = {0, 0, 0};           //!< Vertex buffers OpenCL copies the positions into (replace vbo if isPublishedToRing())
+GLsync positionRingFences[3] = {nullptr, nullptr, nullptr};//!< Signal that the last draw call reading a buffer of positionRing has been finished
+GLsync positionRingReady[3] = {nullptr, nullptr, nullptr}; //!< Signal that OpenCL has finished writing a buffer of positionRing (GL_ARB_cl_event)
 GLuint mbo;
 GLuint lbo;
 GLuint lco;
+GLuint cullProgram;           //!< Compute program which culls and merges the bodies before they are drawn
+GLuint visibleBodiesBuffer = 0;//!< Clip position, color and point size of the bodies left by the cull shader
+GLuint drawCommandBuffer = 0;  //!< Indirect draw command whose count is written by the cull shader
+GLuint cellSizesBuffer = 0;    //!< Largest point size per screen cell (cull shader)
+GLuint cellClaimsBuffer = 0;   //!< Frame stamp of the last point emitted per screen cell (cull shader)
+glm::uvec2 cellGrid(0, 0);     //!< Number of screen cells the cell buffers have been allocated for
+GLuint cullStamp = 0;          //!< Stamp of the current frame in cellClaimsBuffer
+GLuint densityFramebuffer;     //!< Framebuffer the bodies are splatted into in the density mode
+GLuint densityTexture = 0;     //!< Floating point color attachment of densityFramebuffer
+GLuint screenVao;              //!< Vertex array without attributes for the full screen triangle of the tone mapping pass
+glm::uvec2 densitySize(0, 0);  //!< Size of densityTexture
+GLuint trailProgram;           //!< Compute program which appends the current positions to the trails
+GLuint trailBuffer = 0;        //!< Ring of trailLength slots holding the positions of all bodies (created when trails are shown)
+GLuint trailHead = 0;          //!< Slot of trailBuffer holding the newest positions
 extern GLuint vao;
 extern GLuint shaderProgram;
 extern int mainWindow;
@@ -80,6 +111,10 @@ extern glm::mat4 M_projection;
 extern float zoomFactor;
 extern bool copyMatricesToGPU;
 extern bool automaticCameraRotation;
+extern bool cullingEnabled;
+extern bool densityRendering;
+extern bool trailsEnabled;
+extern size_t trailLength;
 
 extern const std::vector<float> coordinateSystemLines;
 extern const std::vector<float> lineColors;
@@ -87,66 +122,526 @@ extern const std::vector<float> lineColors;
 // benchmark
 double executionTime;
 size_t nFrames = 0;
-extern size_t benchmarkLength;
-extern size_t benchmarkWarmUp;
+extern double benchmarkTargetWidth;
+extern double benchmarkTimeBudget;
+BenchmarkController *benchmarkController = nullptr;//!< Decides when the warm-up of the current benchmark run is over and when it is finished
 extern BenchmarkMode benchmark;
 extern PerformanceMetricsCollector *performanceMetricsCollector;
 
+// validation
+extern size_t validationInterval;
+extern size_t simulationStep;
+
+// diagnostics
+extern size_t diagnosticsInterval;
+extern std::string diagnosticsLogFileName;
+
+// Checkpoint variables
+extern size_t checkpointInterval;
+extern std::string checkpointFileName;
+extern size_t restartStep;
+extern float dt;
+extern float BIG_G;
+
+// Trajectory variables
+extern size_t trajectoryInterval;
+extern TrajectoryRecorder *trajectoryRecorder;
+
+// simulation thread
+extern bool threadedSimulation;
+static std::thread simulationThread;           //!< Calculates the simulation steps if threadedSimulation is set
+static std::atomic<bool> stopSimulation{false};//!< Asks the simulation thread to return after its current steps
+static TripleBuffer positionSlots;             //!< Hands the latest positions from the simulation thread to the render thread
+static std::vector<float> hostPositions[3];    //!< Slots of positionSlots if the positions are published through the host
+static std::atomic<size_t> drawnFrames{0};     //!< Number of frames drawn by the render thread
+static size_t printedFrames = 0;               //!< Value of drawnFrames when the simulation thread printed the last result
+
+// offscreen rendering and frame export
+extern bool offscreenRendering;
+extern unsigned frameWidth;
+extern unsigned frameHeight;
+extern size_t frameLimit;
+extern FrameExporter *frameExporter;
+extern bool exitRenderLoop;
+size_t renderedFrames = 0;                         //!< Number of frames drawn so far (for frameLimit)
+static volatile std::sig_atomic_t interrupted = 0;//!< Set by SIGINT to leave the offscreen render loop cleanly
+
+// substeps
+extern size_t stepsPerFrame;
+extern bool adaptiveStepsPerFrame;
+extern double targetFrameRate;
+Core::TimeSpan lastFrameTime = Core::getCurrentTime();//!< Time at which the previous frame has been finished
+double avgStepTime = 0.0;                              //!< Smoothed calculation time of a single step (adaptive mode)
+double avgOverheadTime = 0.0;                          //!< Smoothed time of a frame which is not spent on the simulation (adaptive mode)
+
+/**
+ * @brief Chooses the number of steps for the next frame so that the frame rate approaches the target frame rate
+ *
+ * The frame time is modeled as overhead + steps * step time; both parts are smoothed with an exponential
+ * moving average and the number of steps may at most double from one frame to the next.
+ *
+ * @param calcTime Calculation time of all steps of the current frame in seconds
+ */
+void adaptStepsPerFrame(double calcTime) {
+    Core::TimeSpan currentTime = Core::getCurrentTime();
+    double frameTime = (currentTime - lastFrameTime).getSeconds();
+    lastFrameTime = currentTime;
+
+    const double smoothing = 0.2;
+    double stepTime = calcTime / stepsPerFrame;
+    double overheadTime = (std::max)(0.0, frameTime - calcTime);
+    if (avgStepTime == 0.0) {
+        avgStepTime = stepTime;
+        avgOverheadTime = overheadTime;
+    } else {
+        avgStepTime += smoothing * (stepTime - avgStepTime);
+        avgOverheadTime += smoothing * (overheadTime - avgOverheadTime);
+    }
+
+    // if the overhead alone exceeds the frame time, a single step per frame is the best that can be done
+    double budget = (std::max)(0.0, 1.0 / targetFrameRate - avgOverheadTime);
+    double steps = avgStepTime > 0.0 ? budget / avgStepTime : 2.0 * stepsPerFrame;
+    stepsPerFrame = (std::size_t) (std::max)(1.0, (std::min)(steps, 2.0 * stepsPerFrame));
+}
+
+/**
+ * @brief Waits until the last draw call which reads the positions has been finished
+ */
+static void waitForPositionsFence() {
+    if (positionsFence != nullptr) {
+        glClientWaitSync(positionsFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(positionsFence);
+        positionsFence = nullptr;
+    }
+}
+
+/**
+ * @brief Copies the CPU positions into the vertex buffer
+ *
+ * The positions are flattened directly into the persistently mapped buffer, so a frame needs exactly one copy.
+ * Since the mapping is coherent, the last draw call which reads the buffer has to be finished first.
+ *
+ * @param positions flat positions to copy; nullptr flattens the positions of the data set
+ */
+void updateVertexBuffer(const float *positions = nullptr) {
+    TraceZone zone("vbo_upload", "transfer");
+    float *target;
+    if (mappedPositions != nullptr) {
+        waitForPositionsFence();
+        target = mappedPositions;
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        target = static_cast<float *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, dataSet->getBytesCount(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    }
+    if (positions != nullptr) {
+        std::copy(positions, positions + 3 * dataSet->getSize(), target);
+    } else {
+        dataSet->writeFlatPositions(target);
+    }
+    if (mappedPositions == nullptr) {
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+}
+
+/**
+ * @brief Hands the positions of the finished steps to the render loop (on the simulation thread if there is one)
+ *
+ * The GPU copies its result into a shared vertex buffer if possible; otherwise the positions are flattened into a
+ * host slot, which the render thread uploads.
+ */
+static void publishPositions() {
+    TraceZone zone("publish", "render");
+    if (isPublishedToRing()) {
+        publishPositionsGPU(positionSlots.back());
+    } else {
+        dataSet->writeFlatPositions(hostPositions[positionSlots.back()].data());
+    }
+    positionSlots.publish();
+}
+
+/**
+ * @brief Switches the vertex buffer to the latest published positions
+ *
+ * The slot drawn so far goes back to the simulation, so the draw calls reading it have to be finished before OpenCL
+ * writes to it. OpenCL waits for their fence itself if it supports cl_khr_gl_event; otherwise the host waits here,
+ * which still only waits for the draw calls of this buffer instead of the whole pipeline.
+ *
+ * @return false if nothing has been published since the last call
+ */
+static bool acquireLatestPositions() {
+    if (!positionSlots.hasUpdate())
+        return false;
+    if (!isPublishedToRing()) {
+        positionSlots.update();
+        updateVertexBuffer(hostPositions[positionSlots.front()].data());
+        return true;
+    }
+    GLsync &drawn = positionRingFences[positionSlots.front()];
+    if (drawn != nullptr && !hasGLEventSharing()) {
+        TraceZone waitZone("gl_wait", "render");
+        Core::TimeSpan waitStart = Core::getCurrentTime();
+        glClientWaitSync(drawn, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(drawn);
+        drawn = nullptr;
+        if (!threadedSimulation) {
+            performanceMetricsCollector->addPhaseTime(Phase::GL_FINISH, (Core::getCurrentTime() - waitStart).getSeconds());
+        }
+    }
+    positionSlots.update();
+    unsigned front = positionSlots.front();
+    // the draw call waits on the GPU until the copy of OpenCL has been finished
+    if (positionRingReady[front] != nullptr) {
+        glWaitSync(positionRingReady[front], 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(positionRingReady[front]);
+        positionRingReady[front] = nullptr;
+    }
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, positionRing[front]);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
+    return true;
+}
 
 /**
- * @brief 
+ * @brief Calculates the simulation steps of one frame
  * 
  * @param cpu Whether to let CPU calculate
  * @param gpu Whether to let GPU calculate
  * 
  */
 void calcSimulationStep(bool cpu, bool gpu) {
+    TraceZone zone("calcSimulationStep", "render");
+    std::size_t steps = stepsPerFrame;
     if (gpu) {
-        executionTime = simulateGPU();
+        executionTime = simulateGPU(steps);
     }
     if (cpu) {
-        executionTime = simulateCPU();
+        executionTime = simulateCPU(steps);
     }
+    // the GPU result is copied through the host if the OpenCL context doesn't share the vertex buffer
+    if (threadedSimulation || isPublishedToRing()) {
+        publishPositions();
+    } else if (cpu || isRenderedFromHost()) {
+        Core::TimeSpan uploadStart = Core::getCurrentTime();
+        updateVertexBuffer();
+        performanceMetricsCollector->addPhaseTime(Phase::VBO_UPLOAD, (Core::getCurrentTime() - uploadStart).getSeconds());
+    }
+    simulationStep += steps;
     if (gpu && cpu) {
-        compareResults();
+        TraceZone validationZone("validation", "render");
+        Core::TimeSpan validationStart = Core::getCurrentTime();
+        if (validationInterval == 0) {
+            compareResults();
+        } else if (simulationStep / validationInterval != (simulationStep - steps) / validationInterval) {
+            compareSampledResults(readValidationSampleGPU(), simulationStep);
+        }
+        performanceMetricsCollector->addPhaseTime(Phase::VALIDATION, (Core::getCurrentTime() - validationStart).getSeconds());
+    }
+    if (diagnosticsInterval > 0 && simulationStep / diagnosticsInterval != (simulationStep - steps) / diagnosticsInterval) {
+        TraceZone diagnosticsZone("diagnostics", "render");
+        Core::TimeSpan diagnosticsStart = Core::getCurrentTime();
+        if (gpu) {
+            logDiagnostics(diagnosticsLogFileName, computeDiagnosticsGPU(), dataSet->getSize(), simulationStep, "GPU");
+        }
+        if (cpu) {
+            logDiagnostics(diagnosticsLogFileName, computeDiagnosticsCPU(), dataSet->getSize(), simulationStep, "CPU");
+        }
+        performanceMetricsCollector->addPhaseTime(Phase::DIAGNOSTICS, (Core::getCurrentTime() - diagnosticsStart).getSeconds());
+    }
+    bool checkpoint = checkpointInterval > 0 && simulationStep / checkpointInterval != (simulationStep - steps) / checkpointInterval;
+    bool trajectoryFrame = trajectoryRecorder != nullptr && simulationStep / trajectoryInterval != (simulationStep - steps) / trajectoryInterval;
+    // in CPUGPU mode the CPU state is the reference and already on the host
+    if ((checkpoint || trajectoryFrame) && gpu && !cpu) {
+        downloadStateGPU();
+    }
+    if (trajectoryFrame) {
+        // only copies the bodies; the file is written by the recorder's thread
+        TraceZone trajectoryZone("trajectory", "render");
+        trajectoryRecorder->record(simulationStep, *dataSet);
+    }
+    if (checkpoint) {
+        TraceZone checkpointZone("checkpoint", "render");
+        try {
+            writeSnapshot(checkpointFileName, *dataSet, simulationStep, dt, BIG_G);
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    if (adaptiveStepsPerFrame && !threadedSimulation) {
+        adaptStepsPerFrame(executionTime);
     }
 
-    performanceMetricsCollector->addCalcTime(executionTime);
+    // the calculation time is always recorded per step so that results are comparable for any number of substeps
+    performanceMetricsCollector->addCalcTime(executionTime / steps);
     nFrames++;
     if (benchmark == BenchmarkMode::OFF) {
-        performanceMetricsCollector->printResult();
-    } else if (nFrames == benchmarkLength) {
-        if (performanceMetricsCollector->getCalcTimes().getAvgTime() < 1.0) {
-            std::cout << "Avg calc time is below 1 second => using warm up" << std::endl;
-        } else {
+        // the simulation thread calculates steps much more often than frames are drawn, so it prints once per frame
+        if (!threadedSimulation || printedFrames != drawnFrames.load(std::memory_order_relaxed)) {
+            printedFrames = drawnFrames.load(std::memory_order_relaxed);
+            performanceMetricsCollector->printResult(dataSet->getSize());
+            if (stepsPerFrame > 1 || adaptiveStepsPerFrame) {
+                std::cout << "Steps per frame: " << stepsPerFrame << std::endl;
+            }
+        }
+    } else {
+        BenchmarkController::State previousState = benchmarkController->getState();
+        BenchmarkController::State state = benchmarkController->addSample(executionTime / steps);
+        if (previousState == BenchmarkController::State::WARM_UP && state == BenchmarkController::State::MEASURING) {
+            // only the steady state is measured
+            delete performanceMetricsCollector;
+            performanceMetricsCollector = new PerformanceMetricsCollector();
+        } else if (state == BenchmarkController::State::DONE) {
+            performanceMetricsCollector->setBenchmarkStatus(benchmarkController->getWarmUpSteps(), benchmarkController->hasConverged());
             initialRun = true;
             nFrames = 0;
-            glutLeaveMainLoop();
+            exitRenderLoop = true;
         }
-    } else if (nFrames == benchmarkWarmUp) {
-        delete performanceMetricsCollector;
-        performanceMetricsCollector = new PerformanceMetricsCollector();
-    } else if (nFrames == (benchmarkWarmUp + benchmarkLength)) {
-        initialRun = true;
-        nFrames = 0;
-        glutLeaveMainLoop();
     }
 }
 
-extern bool exitRenderLoop;
+/**
+ * @brief Size of the framebuffer which is drawn to (the window or the offscreen pbuffer)
+ */
+static glm::uvec2 viewportSize() {
+    if (offscreenRendering) {
+        return glm::uvec2(frameWidth, frameHeight);
+    }
+    return glm::uvec2(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+}
+
+/**
+ * @brief Adds up the bodies as splats in a floating point framebuffer and maps the result logarithmically to the screen
+ *
+ * The splats are blended additively without depth test, so the order of the bodies doesn't matter and the cost only
+ * depends on the number of bodies. The tone mapping pass normalizes the weights with their mean, which is read from
+ * the last mipmap level of the accumulation texture.
+ */
+static void drawDensity() {
+    TraceZone zone("density", "render");
+    glm::uvec2 viewport = viewportSize();
+    // e.g. a minimized window
+    if (viewport.x == 0 || viewport.y == 0) {
+        return;
+    }
+    if (viewport != densitySize) {
+        // immutable storage has to be recreated for a new size
+        GLint levels = 1;
+        while ((std::max)(viewport.x, viewport.y) >> levels) {
+            ++levels;
+        }
+        glDeleteTextures(1, &densityTexture);
+        glCreateTextures(GL_TEXTURE_2D, 1, &densityTexture);
+        glTextureStorage2D(densityTexture, levels, GL_RGBA32F, viewport.x, viewport.y);
+        glTextureParameteri(densityTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+        glNamedFramebufferTexture(densityFramebuffer, GL_COLOR_ATTACHMENT0, densityTexture, 0);
+        glProgramUniform1i(shaderProgram, glGetUniformLocation(shaderProgram, "densityMeanLevel"), levels - 1);
+        densitySize = viewport;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, densityFramebuffer);
+    const GLfloat transparent[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearNamedFramebufferfv(densityFramebuffer, GL_COLOR, 0, transparent);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glUniform1ui(modeLoc, 3);
+    glDrawArrays(GL_POINTS, 0, numRenderElements);
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenerateTextureMipmap(densityTexture);
+    glBindTextureUnit(0, densityTexture);
+    glBindVertexArray(screenVao);
+    glUniform1ui(modeLoc, 4);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(vao);
+    glEnable(GL_DEPTH_TEST);
+}
+
+/**
+ * @brief Command read by glDrawArraysIndirect()
+ */
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+/**
+ * @brief Buffer which currently holds the positions to be drawn
+ */
+static GLuint drawnPositions() {
+    return isPublishedToRing() ? positionRing[positionSlots.front()] : vbo;
+}
+
+/**
+ * @brief Culls the bodies outside of the view and merges the bodies which fall into the same screen cell
+ *
+ * The cull shader writes one point per occupied cell of LOD_CELL_SIZE pixels (plus its precomputed color and size)
+ * and the number of these points into drawCommandBuffer, so the cost of the following draw call depends on the
+ * covered part of the screen instead of the number of bodies. The cell buffers follow the size of the window.
+ */
+static void cullBodies() {
+    TraceZone zone("cull", "render");
+    glm::uvec2 viewport = viewportSize();
+    viewport = glm::max(viewport, glm::uvec2(1, 1));
+    glm::uvec2 grid((viewport.x + LOD_CELL_SIZE - 1) / LOD_CELL_SIZE, (viewport.y + LOD_CELL_SIZE - 1) / LOD_CELL_SIZE);
+    if (grid != cellGrid) {
+        // the claims start with 0, which is never a stamp
+        std::vector<GLuint> cells(grid.x * grid.y, 0);
+        glNamedBufferData(cellSizesBuffer, cells.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+        glNamedBufferData(cellClaimsBuffer, cells.size() * sizeof(GLuint), cells.data(), GL_DYNAMIC_COPY);
+        cellGrid = grid;
+        cullStamp = 0;
+    }
+    if (++cullStamp == 0) {
+        glClearNamedBufferData(cellClaimsBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        cullStamp = 1;
+    }
+    glClearNamedBufferData(cellSizesBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    DrawArraysIndirectCommand command = {0, 1, 0, 0};
+    glNamedBufferSubData(drawCommandBuffer, 0, sizeof(command), &command);
+
+    glUseProgram(cullProgram);
+    glm::mat4 mvp = M_projection * M_view * M_model;
+    glUniformMatrix4fv(glGetUniformLocation(cullProgram, "M_mvp"), 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform1f(glGetUniformLocation(cullProgram, "zoomFactor"), zoomFactor);
+    glUniform2ui(glGetUniformLocation(cullProgram, "viewport"), viewport.x, viewport.y);
+    glUniform2ui(glGetUniformLocation(cullProgram, "grid"), grid.x, grid.y);
+    glUniform1ui(glGetUniformLocation(cullProgram, "stamp"), cullStamp);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawnPositions());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleBodiesBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, drawCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, cellSizesBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, cellClaimsBuffer);
+
+    GLuint groups = static_cast<GLuint>((numRenderElements + 255) / 256);
+    int passLoc = glGetUniformLocation(cullProgram, "cullPass");
+    glUniform1ui(passLoc, 0);
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glUniform1ui(passLoc, 1);
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+/**
+ * @brief Appends the drawn positions to the trails of the bodies
+ *
+ * The trail buffer is only allocated while trails are shown, because it holds trailLength copies of all positions.
+ * A new buffer is filled completely with the current positions. Everything stays on the GPU: the compute pass reads
+ * the same buffer as the draw calls and writes one slot, so a frame costs O(N) regardless of the trail length.
+ */
+static void appendTrails() {
+    TraceZone zone("trails", "render");
+    bool reset = trailBuffer == 0;
+    if (reset) {
+        glCreateBuffers(1, &trailBuffer);
+        glNamedBufferStorage(trailBuffer, trailLength * dataSet->getBytesCount(), nullptr, 0);
+        trailHead = 0;
+    } else {
+        trailHead = (trailHead + 1) % trailLength;
+    }
+    glUseProgram(trailProgram);
+    glUniform1ui(glGetUniformLocation(trailProgram, "trailHead"), trailHead);
+    glUniform1ui(glGetUniformLocation(trailProgram, "trailReset"), reset);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawnPositions());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, trailBuffer);
+    glDispatchCompute(static_cast<GLuint>((numRenderElements + 255) / 256), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/**
+ * @brief Draws the trails as line segments which fade out with the age of their positions
+ *
+ * The vertices are fetched from the trail buffer by their index, so no vertex attributes are used and screenVao is
+ * bound instead of vao. The trails don't write depth, so they never hide bodies behind them.
+ */
+static void drawTrails() {
+    TraceZone zone("draw_trails", "render");
+    glUniform1ui(glGetUniformLocation(shaderProgram, "trailHead"), trailHead);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, trailBuffer);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(screenVao);
+    glUniform1ui(modeLoc, 5);
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(2 * (trailLength - 1) * numRenderElements));
+    glBindVertexArray(vao);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+}
+
+/**
+ * @brief Calculates steps until stopSimulationThread() is called; every stepsPerFrame steps the positions are published
+ */
+static void simulationLoop() {
+    while (!stopSimulation.load(std::memory_order_acquire)) {
+        calcSimulationStep(useCPU, useGPU);
+    }
+}
+
+/**
+ * @brief Starts the simulation thread (only if threadedSimulation is set)
+ *
+ * Every slot of positionSlots holds the complete positions, so the slots are allocated once before the thread starts.
+ */
+static void startSimulationThread() {
+    if (!threadedSimulation || simulationThread.joinable())
+        return;
+    if (!isPublishedToRing()) {
+        for (std::vector<float> &slot : hostPositions)
+            slot.resize(3 * dataSet->getSize());
+    }
+    stopSimulation.store(false, std::memory_order_release);
+    simulationThread = std::thread(simulationLoop);
+}
+
+/**
+ * @brief Stops the simulation thread after its current steps and waits for it
+ *
+ * Has to be called before the data set or the buffers it writes to are released.
+ */
+void stopSimulationThread() {
+    if (!simulationThread.joinable())
+        return;
+    stopSimulation.store(true, std::memory_order_release);
+    simulationThread.join();
+}
 
 /**
  * @brief Rendering function which is called repeatedly by glutMainLoop(); its task is to copy altered matrices to the GPU, draw all bodies that are pending
  * in the buffer and manage all necessary recalculations for the simulation
  */
 void render() {
+    TraceZone zone("render", "render");
     if (initialRun) {
         modeLoc = glGetUniformLocation(shaderProgram, "mode");
         glEnable(GL_POINT_SMOOTH);
         glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
         glEnable(GL_DEPTH_TEST);
         performanceMetricsCollector = new PerformanceMetricsCollector;
+        if (benchmark != BenchmarkMode::OFF) {
+            delete benchmarkController;
+            benchmarkController = new BenchmarkController(benchmarkTargetWidth, benchmarkTimeBudget);
+        }
+        simulationStep = restartStep;
+        if (diagnosticsInterval > 0) {
+            // the energy drift of every run is measured against its own initial state
+            resetDiagnosticsBaseline();
+            if (useGPU) {
+                logDiagnostics(diagnosticsLogFileName, computeDiagnosticsGPU(), dataSet->getSize(), simulationStep, "GPU");
+            }
+            if (useCPU) {
+                logDiagnostics(diagnosticsLogFileName, computeDiagnosticsCPU(), dataSet->getSize(), simulationStep, "CPU");
+            }
+        }
+        // the first frame time must not include the initialization
+        lastFrameTime = Core::getCurrentTime();
         initialRun = false;
+        startSimulationThread();
     }
     if (copyMatricesToGPU) {
         glUniformMatrix4fv(M_model_loc, 1, GL_FALSE, glm::value_ptr(M_model));
@@ -155,22 +650,125 @@ void render() {
         glUniform1f(zoomFactorLoc, zoomFactor);
         copyMatricesToGPU = false;
     }
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(shaderProgram);
-    glBindVertexArray(vao);
-    // Drawing Bodies
-    glUniform1ui(modeLoc, 0);
-    glDrawArrays(GL_POINTS, 0, numRenderElements);
-    // Drawing Coordinate System Axes
-    glUniform1ui(modeLoc, 1);
-    glDrawArrays(GL_LINES, 0, 6);
-    glutSwapBuffers();
-    calcSimulationStep(useCPU, useGPU);
+    // without a simulation thread or ring the vertex buffer has been updated by the steps of the previous frame
+    bool newPositions = true;
+    if (threadedSimulation || isPublishedToRing()) {
+        newPositions = acquireLatestPositions();
+    }
+    {
+        TraceZone drawZone("draw", "render");
+        Core::TimeSpan drawStart = Core::getCurrentTime();
+        if (trailsEnabled) {
+            if (newPositions || trailBuffer == 0) {
+                appendTrails();
+            }
+        } else if (trailBuffer != 0) {
+            glDeleteBuffers(1, &trailBuffer);
+            trailBuffer = 0;
+        }
+        if (cullingEnabled && !densityRendering) {
+            cullBodies();
+        }
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glUseProgram(shaderProgram);
+        glBindVertexArray(vao);
+        if (trailsEnabled && !densityRendering) {
+            drawTrails();
+        }
+        // Drawing Bodies
+        if (densityRendering) {
+            drawDensity();
+        } else if (cullingEnabled) {
+            glUniform1ui(modeLoc, 2);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer);
+            glDrawArraysIndirect(GL_POINTS, nullptr);
+        } else {
+            glUniform1ui(modeLoc, 0);
+            glDrawArrays(GL_POINTS, 0, numRenderElements);
+        }
+        if (mappedPositions != nullptr) {
+            positionsFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        } else if (isPublishedToRing()) {
+            // OpenCL may only write to this buffer again after the fence has been signaled
+            GLsync &drawn = positionRingFences[positionSlots.front()];
+            if (drawn != nullptr) {
+                glDeleteSync(drawn);
+            }
+            drawn = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        // Drawing Coordinate System Axes
+        glUniform1ui(modeLoc, 1);
+        glDrawArrays(GL_LINES, 0, 6);
+        if (frameExporter != nullptr) {
+            frameExporter->capture();
+        }
+        // a pbuffer has no back buffer
+        if (!offscreenRendering) {
+            glutSwapBuffers();
+        }
+        // the collector belongs to the simulation thread in threaded mode
+        if (!threadedSimulation) {
+            performanceMetricsCollector->addPhaseTime(Phase::DRAW, (Core::getCurrentTime() - drawStart).getSeconds());
+        } else {
+            drawnFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!threadedSimulation) {
+        calcSimulationStep(useCPU, useGPU);
+    }
     if (automaticCameraRotation) {
         M_view = glm::rotate(M_view, 0.01f, glm::vec3(0, 1, 0));
         copyMatricesToGPU = true;
     }
+    if (frameLimit > 0 && ++renderedFrames >= frameLimit) {
+        if (offscreenRendering) {
+            exitRenderLoop = true;
+        } else {
+            glutLeaveMainLoop();
+        }
+    }
+}
+
+static void interruptRenderLoop(int) {
+    interrupted = 1;
+}
+
+/**
+ * @brief Replaces glutMainLoop() for one benchmark run: renders frames until the run is finished
+ *
+ * glutMainLoop() deinitializes GLUT when it returns, which destroys the window together with the OpenGL context, so
+ * the events are processed here instead and the window, contexts, shaders and kernels survive for the next run.
+ *
+ * @return false if the window has been closed, which ends the benchmark
+ */
+bool runBenchmarkLoop() {
+    exitRenderLoop = false;
+    while (!exitRenderLoop) {
+        // glutCleanup() has already released the OpenGL resources then
+        if (glutGetWindow() == 0) {
+            return false;
+        }
+        // what the idle function does in glutMainLoop()
+        glutPostRedisplay();
+        glutMainLoopEvent();
+    }
+    return true;
+}
+
+/**
+ * @brief Replaces glutMainLoop() in the offscreen mode: renders frames until the frame limit or Ctrl+C is reached
+ *
+ * Ctrl+C only ends the loop, so that the pending frames, the trajectory and the encoder are still finished properly.
+ */
+void runOffscreenLoop() {
+    exitRenderLoop = false;
+    interrupted = 0;
+    std::signal(SIGINT, interruptRenderLoop);
+    while (!exitRenderLoop && !interrupted) {
+        render();
+    }
+    std::signal(SIGINT, SIG_DFL);
 }
 
 
@@ -178,22 +776,29 @@ int openGlInit(int argc, char *argv[]) {
     //**********************
     // OpenGL initialization
     //**********************
-    glutInit(&argc, argv);
-    glutInitWindowPosition(-1, -1);
-    glutInitWindowSize(SCREEN_WIDTH, SCREEN_HEIGHT);
-    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
-    mainWindow = glutCreateWindow(WINDOW_TITLE);
-    glutDisplayFunc(render);
-    glutKeyboardFunc(glKeyboardCallback);
-    glutMotionFunc(glMouseMovementClickCallback);
-    glutCloseFunc(glutCleanup);
-    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_CONTINUE_EXECUTION);
+    if (offscreenRendering) {
+        // no window and no callbacks; runOffscreenLoop() drives render()
+        if (!createOffscreenContext(frameWidth, frameHeight)) {
+            return 1;
+        }
+    } else {
+        glutInit(&argc, argv);
+        glutInitWindowPosition(-1, -1);
+        glutInitWindowSize(frameWidth, frameHeight);
+        glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
+        mainWindow = glutCreateWindow(WINDOW_TITLE);
+        glutDisplayFunc(render);
+        glutKeyboardFunc(glKeyboardCallback);
+        glutMotionFunc(glMouseMovementClickCallback);
+        glutCloseFunc(glutCleanup);
+        glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_CONTINUE_EXECUTION);
 #ifdef __unix__
-    glutMouseFunc(glMouseWheelCallback);
+        glutMouseFunc(glMouseWheelCallback);
 #elif _WIN32
-    glutMouseWheelFunc(glMouseWheelCallback);
+        glutMouseWheelFunc(glMouseWheelCallback);
 #endif
-    glutIdleFunc(glutPostRedisplay);
+        glutIdleFunc(glutPostRedisplay);
+    }
 
     glewInit();
 
@@ -205,6 +810,12 @@ int openGlInit(int argc, char *argv[]) {
     std::string fragmentShaderCode =
     #include FRAGMENT_SHADER_PATH
     ;
+    std::string cullShaderCode =
+    #include CULL_SHADER_PATH
+    ;
+    std::string trailShaderCode =
+    #include TRAIL_SHADER_PATH
+    ;
     // clang-format on
     GLint isCompiled = -1;
     char shaderInfoLog[512];
@@ -251,13 +862,59 @@ int openGlInit(int argc, char *argv[]) {
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    // Generate Vertex Buffer
-    vbo = 0;
-    glGenBuffers(1, &vbo);
+    shaderCode = cullShaderCode.c_str();
+    uint cullShader;
+    cullShader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(cullShader, 1, &shaderCode, nullptr);
+    glCompileShader(cullShader);
 
-    // Generate Color Buffer
+    glGetShaderiv(cullShader, GL_COMPILE_STATUS, &isCompiled);
+    if (GL_FALSE == isCompiled) {
+        glGetShaderInfoLog(cullShader, 512, NULL, shaderInfoLog);
+        std::cerr << "Cull Shader compilation failed. Error: " << shaderInfoLog << "\n";
+        glDeleteShader(cullShader);
+        return isCompiled;
+    }
+    cullProgram = glCreateProgram();
+    glAttachShader(cullProgram, cullShader);
+    glLinkProgram(cullProgram);
+    glDeleteShader(cullShader);
+    glProgramUniform1ui(cullProgram, glGetUniformLocation(cullProgram, "cellSize"), LOD_CELL_SIZE);
+
+    shaderCode = trailShaderCode.c_str();
+    uint trailShader;
+    trailShader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(trailShader, 1, &shaderCode, nullptr);
+    glCompileShader(trailShader);
+
+    glGetShaderiv(trailShader, GL_COMPILE_STATUS, &isCompiled);
+    if (GL_FALSE == isCompiled) {
+        glGetShaderInfoLog(trailShader, 512, NULL, shaderInfoLog);
+        std::cerr << "Trail Shader compilation failed. Error: " << shaderInfoLog << "\n";
+        glDeleteShader(trailShader);
+        return isCompiled;
+    }
+    trailProgram = glCreateProgram();
+    glAttachShader(trailProgram, trailShader);
+    glLinkProgram(trailProgram);
+    glDeleteShader(trailShader);
+    glProgramUniform1ui(trailProgram, glGetUniformLocation(trailProgram, "trailLength"), trailLength);
+    glProgramUniform1ui(shaderProgram, glGetUniformLocation(shaderProgram, "trailLength"), trailLength);
+
+    // the vertex and mass buffers depend on the data set and are created in uploadDataSet()
+    vbo = 0;
     mbo = 0;
-    glGenBuffers(1, &mbo);
+
+    // the cell buffers depend on the window size and are sized in cullBodies()
+    glCreateBuffers(1, &cellSizesBuffer);
+    glCreateBuffers(1, &cellClaimsBuffer);
+    glCreateBuffers(1, &drawCommandBuffer);
+    glNamedBufferData(drawCommandBuffer, sizeof(DrawArraysIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+
+    // the texture of the density framebuffer depends on the window size and is created in drawDensity()
+    glCreateFramebuffers(1, &densityFramebuffer);
+    glCreateVertexArrays(1, &screenVao);
+    glUniform1i(glGetUniformLocation(shaderProgram, "densityTexture"), 0);
 
     // Generate Line Buffer
     lbo = 0;
@@ -271,17 +928,6 @@ int openGlInit(int argc, char *argv[]) {
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * dataSet->getFlatPositions().size(), dataSet->getFlatPositions().data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
-    glEnableVertexArrayAttrib(vao, 0);
-
-
-    glBindBuffer(GL_ARRAY_BUFFER, mbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * dataSet->getMasses().size(), dataSet->getMasses().data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
-    glEnableVertexArrayAttrib(vao, 1);
-
     glBindBuffer(GL_ARRAY_BUFFER, lbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * coordinateSystemLines.size(), coordinateSystemLines.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
@@ -303,7 +949,7 @@ int openGlInit(int argc, char *argv[]) {
     // Init Vertex Matrices
     M_model = glm::mat4(1.0f);
     M_view = glm::lookAt(eyeVector, centerVector, upVector);
-    M_projection = glm::perspective(glm::radians(FOV), static_cast<float>(SCREEN_WIDTH) / SCREEN_HEIGHT, 0.001f, 300.0f);
+    M_projection = glm::perspective(glm::radians(FOV), static_cast<float>(frameWidth) / frameHeight, 0.001f, 300.0f);
 
     M_model_loc = glGetUniformLocation(shaderProgram, "M_model");
     M_view_loc = glGetUniformLocation(shaderProgram, "M_view");
@@ -312,6 +958,115 @@ int openGlInit(int argc, char *argv[]) {
     glUniformMatrix4fv(M_view_loc, 1, GL_FALSE, glm::value_ptr(M_view));
     glUniformMatrix4fv(M_projection_loc, 1, GL_FALSE, glm::value_ptr(M_projection));
 
+    zoomFactorLoc = glGetUniformLocation(shaderProgram, "zoomFactor");
+    glUniform1f(zoomFactorLoc, zoomFactor);
+    return 0;
+}
+
+/**
+ * @brief Unmaps and deletes the buffers holding the positions and masses of the current data set
+ */
+static void releaseDataSetBuffers() {
+    if (positionsFence != nullptr) {
+        glDeleteSync(positionsFence);
+        positionsFence = nullptr;
+    }
+    if (mappedPositions != nullptr) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mappedPositions = nullptr;
+    }
+    if (vbo != 0) {
+        glDeleteBuffers(1, &vbo);
+        vbo = 0;
+    }
+    if (mbo != 0) {
+        glDeleteBuffers(1, &mbo);
+        mbo = 0;
+    }
+    if (visibleBodiesBuffer != 0) {
+        glDeleteBuffers(1, &visibleBodiesBuffer);
+        visibleBodiesBuffer = 0;
+    }
+    // recreated by the next frame if trails are shown
+    if (trailBuffer != 0) {
+        glDeleteBuffers(1, &trailBuffer);
+        trailBuffer = 0;
+    }
+    for (GLsync *syncs : {positionRingFences, positionRingReady}) {
+        for (int slot = 0; slot < 3; ++slot) {
+            if (syncs[slot] != nullptr) {
+                glDeleteSync(syncs[slot]);
+                syncs[slot] = nullptr;
+            }
+        }
+    }
+    if (positionRing[0] != 0) {
+        glDeleteBuffers(3, positionRing);
+        std::fill(positionRing, positionRing + 3, 0);
+    }
+}
+
+/**
+ * @brief Creates the vertex buffers for the current data set
+ *
+ * Window, shaders and coordinate system created by openGlInit() are reused, so only this function (and gpuInit())
+ * has to be called again if the data set changes. The position buffer is recreated because its storage is immutable
+ * if it is mapped persistently; gpuInit() has to be called afterwards to share the new buffers with OpenCL.
+ * openClInit() has to be called first, because the position buffers depend on whether OpenCL can share them.
+ */
+void uploadDataSet() {
+    releaseDataSetBuffers();
+
+    // Generate Color Buffer
+    glGenBuffers(1, &mbo);
+
+    glBindVertexArray(vao);
+    if (isPublishedToRing()) {
+        // OpenCL copies every finished state into the next buffer of the ring while OpenGL draws the previous one
+        std::vector<float> positions = dataSet->getFlatPositions();
+        glGenBuffers(3, positionRing);
+        for (GLuint buffer : positionRing) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, dataSet->getBytesCount(), positions.data(), GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, positionRing[positionSlots.front()]);
+    } else {
+        // Generate Vertex Buffer
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        // If the CPU calculates the rendered positions, the buffer is mapped once for its whole lifetime.
+        if (useCPU && GLEW_ARB_buffer_storage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, dataSet->getBytesCount(), dataSet->getFlatPositions().data(), flags);
+            mappedPositions = static_cast<float *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, dataSet->getBytesCount(), flags));
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, dataSet->getBytesCount(), dataSet->getFlatPositions().data(), GL_DYNAMIC_DRAW);
+        }
+    }
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
+    glEnableVertexArrayAttrib(vao, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * dataSet->getMasses().size(), dataSet->getMasses().data(), GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
+    glEnableVertexArrayAttrib(vao, 1);
+
+    // In the worst case every body is visible in a cell of its own
+    glGenBuffers(1, &visibleBodiesBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, visibleBodiesBuffer);
+    glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(float) * dataSet->getSize(), nullptr, GL_DYNAMIC_COPY);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), static_cast<void *>(0));
+    glEnableVertexArrayAttrib(vao, 4);
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void *>(4 * sizeof(float)));
+    glEnableVertexArrayAttrib(vao, 5);
+    glProgramUniform1f(cullProgram, glGetUniformLocation(cullProgram, "minMass"), dataSet->getMinMass());
+    glProgramUniform1f(cullProgram, glGetUniformLocation(cullProgram, "maxMass"), dataSet->getMaxMass());
+    glProgramUniform1f(cullProgram, glGetUniformLocation(cullProgram, "maxPos"), dataSet->getMaxPosition());
+    glProgramUniform1ui(cullProgram, glGetUniformLocation(cullProgram, "nrBodies"), dataSet->getSize());
+    glProgramUniform1ui(trailProgram, glGetUniformLocation(trailProgram, "nrBodies"), dataSet->getSize());
+
+    glUseProgram(shaderProgram);
     int minMass_loc = glGetUniformLocation(shaderProgram, "minMass");
     int maxMass_loc = glGetUniformLocation(shaderProgram, "maxMass");
     glUniform1f(minMass_loc, dataSet->getMinMass());
@@ -319,17 +1074,22 @@ int openGlInit(int argc, char *argv[]) {
 
     int maxPos_loc = glGetUniformLocation(shaderProgram, "maxPos");
     glUniform1f(maxPos_loc, dataSet->getMaxPosition());
+    glUniform1ui(glGetUniformLocation(shaderProgram, "nrBodies"), dataSet->getSize());
     numRenderElements = dataSet->getSize();
-
-    zoomFactorLoc = glGetUniformLocation(shaderProgram, "zoomFactor");
-    glUniform1f(zoomFactorLoc, zoomFactor);
-    return 0;
 }
 
 void glutCleanup() {
+    stopSimulationThread();
+    releaseDataSetBuffers();
     glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &mbo);
     glDeleteBuffers(1, &lbo);
     glDeleteBuffers(1, &lco);
+    glDeleteBuffers(1, &cellSizesBuffer);
+    glDeleteBuffers(1, &cellClaimsBuffer);
+    glDeleteBuffers(1, &drawCommandBuffer);
+    glDeleteProgram(cullProgram);
+    glDeleteProgram(trailProgram);
+    glDeleteTextures(1, &densityTexture);
+    glDeleteFramebuffers(1, &densityFramebuffer);
+    glDeleteVertexArrays(1, &screenVao);
 }
\ No newline at end of file
@@ -11,27 +11,16 @@
 
 #include "../../include/Simulation/CPUCalc.hpp"
 #include "../../include/Data/AbstractData.hpp"
-#include "../../include/PerformanceMetrics/PerformanceMetric.hpp"
-// clang-format off
-#include <GL/glew.h>
-#include <GL/freeglut.h>
-
-#ifdef __unix__
-#include <GL/glx.h>
-#elif _WIN32
-#include <GL/GL.h>
-#endif
-
-// clang-format on
+#include "../../include/PerformanceMetrics/PerfCounters.hpp"
+#include "../../include/PerformanceMetrics/PerformanceMetricsCollector.hpp"
+#include "../../include/PerformanceMetrics/Trace.hpp"
 #include "../../lib/Core/Time.hpp"
-#include "glm/gtc/type_ptr.hpp"
-#include "glm/mat4x4.hpp"
 
+#include <cmath>
 #include <iostream>
 
-extern GLuint vbo;
-
 extern AbstractData *dataSet;
+extern PerformanceMetricsCollector *performanceMetricsCollector;
 
 #define p dataSet->positions
 #define v dataSet->velocities
@@ -40,37 +29,57 @@ extern AbstractData *dataSet;
 float dt = 86400;
 float BIG_G = 6.67e-11;
 
-double simulateCPU() {
+/**
+ * @brief Calculates the given number of simulation steps on the CPU
+ *
+ * @param steps Number of simulation steps calculated before the result is rendered
+ * @return double time needed for the calculation in seconds
+ */
+double simulateCPU(std::size_t steps) {
+    TraceZone zone("simulateCPU", "cpu");
     Core::TimeSpan timeCPU1 = Core::getCurrentTime();
 
-#pragma omp parallel for default(none) shared(dataSet, dt, BIG_G)
-    for (std::size_t i = 0; i < dataSet->getSize(); ++i) {
-        float3 acceleration(0.0);
-        for (size_t j = 0; j < dataSet->getSize(); ++j) {
-            if (i != j) {
-                float3 r_vector = p[i] - p[j];
-                float r_mag = std::sqrt(dot(r_vector, r_vector));
-                float acc = -1.0f * BIG_G * (m[j] / std::pow(r_mag, 2.0));
-                float3 r_unit_vector = r_vector / r_mag;
-                acceleration += r_unit_vector * acc;
+    for (std::size_t step = 0; step < steps; ++step) {
+        Core::TimeSpan forceStart = Core::getCurrentTime();
+        // the parallel region is opened explicitly, so that the trace shows the share of every thread
+#pragma omp parallel default(none) shared(dataSet, dt, BIG_G)
+        {
+            TraceZone forceZone("cpu_force", "cpu");
+            PerfCounterScope counterScope;
+            // no barrier inside the scope, otherwise the counters would include the time a thread waits for the others
+#pragma omp for nowait
+            for (std::size_t i = 0; i < dataSet->getSize(); ++i) {
+                float3 acceleration(0.0);
+                for (size_t j = 0; j < dataSet->getSize(); ++j) {
+                    if (i != j) {
+                        float3 r_vector = p[i] - p[j];
+                        float r_mag = std::sqrt(dot(r_vector, r_vector));
+                        float acc = -1.0f * BIG_G * (m[j] / std::pow(r_mag, 2.0));
+                        float3 r_unit_vector = r_vector / r_mag;
+                        acceleration += r_unit_vector * acc;
+                    }
+                }
+                v[i] += acceleration * dt;
             }
         }
-        v[i] += acceleration * dt;
-    }
+        Core::TimeSpan updateStart = Core::getCurrentTime();
+        performanceMetricsCollector->addPhaseTime(Phase::CPU_FORCE, (updateStart - forceStart).getSeconds());
+        if (PerfCounters::isEnabled())
+            performanceMetricsCollector->addCounters(PerfCounters::collect());
 
-
-#pragma omp parallel for default(none) shared(dataSet, dt)
-    for (std::size_t i = 0; i < dataSet->getSize(); ++i) {
-        p[i] += v[i] * dt;
+#pragma omp parallel default(none) shared(dataSet, dt)
+        {
+            TraceZone updateZone("cpu_update", "cpu");
+#pragma omp for
+            for (std::size_t i = 0; i < dataSet->getSize(); ++i) {
+                p[i] += v[i] * dt;
+            }
+        }
+        performanceMetricsCollector->addPhaseTime(Phase::CPU_UPDATE, (Core::getCurrentTime() - updateStart).getSeconds());
     }
 
     Core::TimeSpan timeCPU2 = Core::getCurrentTime();
     Core::TimeSpan executionTime = timeCPU2 - timeCPU1;
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    void *ptr = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-    memcpy(ptr, dataSet->getFlatPositions().data(), dataSet->getBytesCount());
-    glUnmapBuffer(GL_ARRAY_BUFFER);
-
     return executionTime.getSeconds();
 }
\ No newline at end of file
@@ -9,23 +9,112 @@
 *
 */
 
+#include <algorithm>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <cmath>
 #include <iostream>
+#include <numeric>
 
 #include "../../include/Simulation/CompareResults.hpp"
 #include "../../include/Data/AbstractData.hpp"
+#include "../../include/Simulation/Transfer.hpp"
 
 extern AbstractData *dataSet;
-extern std::vector<float3> h_pos;
+extern PinnedHostBuffer h_stagingPos;
+extern std::vector<int> validationIndices;
 
 void compareResults() {
-    // check if GPU and CPU results are the same
+    // check if GPU and CPU results are the same; the GPU positions have been read back flat into the staging memory
+    const float *gpuPositions = h_stagingPos.data();
     float errorSum = 0.0;
     float avgValue = 0.0;
     for (size_t i=0; i<dataSet->getSize(); ++i) {
-        errorSum += distance(h_pos[i], dataSet->getPositions()[i]);
+        float3 gpuPos(gpuPositions[3 * i], gpuPositions[3 * i + 1], gpuPositions[3 * i + 2]);
+        errorSum += distance(gpuPos, dataSet->getPositions()[i]);
         avgValue += std::sqrt(dot(dataSet->getPositions()[i], dataSet->getPositions()[i]));
     }
     avgValue /= (float) dataSet->getSize();
     errorSum /= (float) dataSet->getSize();
     std::cout << "Average value: "<< avgValue <<", Average error: " << errorSum << ", Relative error: " << errorSum / avgValue << std::endl;
 }
+
+/**
+ * @brief Chooses the bodies which are compared in the validation mode
+ *
+ * The indices are drawn without replacement and returned in ascending order so that
+ * the gather kernel reads the positions with as little scattering as possible.
+ *
+ * @param nrBodies Number of bodies in the data set
+ * @param sampleSize Number of bodies to compare; 0 or a value >= nrBodies selects all bodies
+ * @param seed Seed of the random sample
+ * @return std::vector<int> Indices of the sampled bodies
+ */
+std::vector<int> selectValidationSample(std::size_t nrBodies, std::size_t sampleSize, uint64_t seed) {
+    std::vector<int> indices(nrBodies);
+    std::iota(indices.begin(), indices.end(), 0);
+    if (sampleSize == 0 || sampleSize >= nrBodies) {
+        return indices;
+    }
+
+    // partial Fisher-Yates shuffle: the first sampleSize entries form the sample
+    boost::random::mt19937 gen(static_cast<uint32_t>(seed ^ (seed >> 32)));
+    for (std::size_t i = 0; i < sampleSize; ++i) {
+        boost::random::uniform_int_distribution<std::size_t> dist(i, nrBodies - 1);
+        std::swap(indices[i], indices[dist(gen)]);
+    }
+    indices.resize(sampleSize);
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+double firstRelativeError = 0.0;//!< Relative error of the first validation, used as reference for the divergence growth
+double lastRelativeError = 0.0; //!< Relative error of the previous validation
+std::size_t lastValidationStep = 0;
+
+/**
+ * @brief Compares the independently evolved GPU positions of the validation sample with the CPU data set
+ *
+ * Besides the current error, the growth of the divergence since the last validation is reported as
+ * exponential rate per step, i.e. ln(error / previous error) / steps.
+ *
+ * @param gpuPositions Flat positions (stride 3) of the sampled bodies as calculated by the GPU
+ * @param step Current simulation step
+ */
+void compareSampledResults(const std::vector<float> &gpuPositions, std::size_t step) {
+    if (step <= lastValidationStep) {
+        // a new simulation run has been started
+        lastValidationStep = 0;
+        firstRelativeError = 0.0;
+        lastRelativeError = 0.0;
+    }
+    const std::vector<float3> &cpuPositions = dataSet->getPositions();
+    double errorSum = 0.0;
+    double maxError = 0.0;
+    double avgValue = 0.0;
+    for (std::size_t i = 0; i < validationIndices.size(); ++i) {
+        const float3 &cpuPos = cpuPositions[validationIndices[i]];
+        float3 gpuPos(gpuPositions[3 * i], gpuPositions[3 * i + 1], gpuPositions[3 * i + 2]);
+        double error = distance(gpuPos, cpuPos);
+        errorSum += error;
+        maxError = (std::max)(maxError, error);
+        avgValue += std::sqrt(dot(cpuPos, cpuPos));
+    }
+    avgValue /= (double) validationIndices.size();
+    errorSum /= (double) validationIndices.size();
+    double relativeError = errorSum / avgValue;
+
+    std::cout << "Validation at step " << step << " (" << validationIndices.size() << " bodies): ";
+    std::cout << "Average error: " << errorSum << ", Max error: " << maxError << ", Relative error: " << relativeError;
+    if (lastValidationStep > 0 && lastRelativeError > 0.0 && relativeError > 0.0) {
+        double growthRate = std::log(relativeError / lastRelativeError) / (double) (step - lastValidationStep);
+        std::cout << ", Growth since first: x" << relativeError / firstRelativeError << ", Growth rate: " << growthRate << "/step";
+    }
+    std::cout << std::endl;
+
+    if (firstRelativeError == 0.0) {
+        firstRelativeError = relativeError;
+    }
+    lastRelativeError = relativeError;
+    lastValidationStep = step;
+}
@@ -0,0 +1,165 @@
+/**
+* @file Diagnostics.cpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains the OpenMP implementation of the conservation diagnostics and their CSV logging
+* @version 1
+* @date 2022-02-09
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#include "../../include/Simulation/Diagnostics.hpp"
+#include "../../include/Data/AbstractData.hpp"
+#include "../../include/PerformanceMetrics/PerformanceMetricsCollector.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <vector>
+
+extern AbstractData *dataSet;
+extern float BIG_G;
+
+/**
+ * @brief Calculates energies, momenta, center of mass and bounding box of the CPU data set
+ *
+ * The potential energy needs all pairwise distances and therefore costs about as much as one force calculation;
+ * all other quantities are simple reductions.
+ *
+ * @return Diagnostics of the current state
+ */
+Diagnostics computeDiagnosticsCPU() {
+    const std::vector<float3> &positions = dataSet->getPositions();
+    const std::vector<float3> &velocities = dataSet->getVelocities();
+    std::vector<float> masses = dataSet->getMasses();
+    std::size_t n = dataSet->getSize();
+
+    double kinetic = 0.0, potential = 0.0, mass = 0.0;
+    double px = 0.0, py = 0.0, pz = 0.0;
+    double lx = 0.0, ly = 0.0, lz = 0.0;
+    double mx = 0.0, my = 0.0, mz = 0.0;
+    double minX = std::numeric_limits<double>::infinity(), minY = minX, minZ = minX;
+    double maxX = -std::numeric_limits<double>::infinity(), maxY = maxX, maxZ = maxX;
+
+#pragma omp parallel for default(none) shared(positions, velocities, masses, n, BIG_G) reduction(+ : kinetic, potential, mass, px, py, pz, lx, ly, lz, mx, my, mz) reduction(min : minX, minY, minZ) reduction(max : maxX, maxY, maxZ)
+    for (std::size_t i = 0; i < n; ++i) {
+        double x = positions[i].x, y = positions[i].y, z = positions[i].z;
+        double vx = velocities[i].x, vy = velocities[i].y, vz = velocities[i].z;
+        double m = masses[i];
+
+        double bodyPotential = 0.0;
+        for (std::size_t j = 0; j < n; ++j) {
+            if (i != j) {
+                bodyPotential += masses[j] / distance(positions[i], positions[j]);
+            }
+        }
+        // every pair is visited twice
+        potential += -0.5 * BIG_G * m * bodyPotential;
+
+        kinetic += 0.5 * m * (vx * vx + vy * vy + vz * vz);
+        mass += m;
+        px += m * vx;
+        py += m * vy;
+        pz += m * vz;
+        lx += m * (y * vz - z * vy);
+        ly += m * (z * vx - x * vz);
+        lz += m * (x * vy - y * vx);
+        mx += m * x;
+        my += m * y;
+        mz += m * z;
+        minX = (std::min)(minX, x);
+        minY = (std::min)(minY, y);
+        minZ = (std::min)(minZ, z);
+        maxX = (std::max)(maxX, x);
+        maxY = (std::max)(maxY, y);
+        maxZ = (std::max)(maxZ, z);
+    }
+
+    Diagnostics diagnostics;
+    diagnostics.kineticEnergy = kinetic;
+    diagnostics.potentialEnergy = potential;
+    diagnostics.totalMass = mass;
+    diagnostics.momentum[0] = px;
+    diagnostics.momentum[1] = py;
+    diagnostics.momentum[2] = pz;
+    diagnostics.angularMomentum[0] = lx;
+    diagnostics.angularMomentum[1] = ly;
+    diagnostics.angularMomentum[2] = lz;
+    diagnostics.centerOfMass[0] = mx / mass;
+    diagnostics.centerOfMass[1] = my / mass;
+    diagnostics.centerOfMass[2] = mz / mass;
+    diagnostics.boundsMin[0] = minX;
+    diagnostics.boundsMin[1] = minY;
+    diagnostics.boundsMin[2] = minZ;
+    diagnostics.boundsMax[0] = maxX;
+    diagnostics.boundsMax[1] = maxY;
+    diagnostics.boundsMax[2] = maxZ;
+    return diagnostics;
+}
+
+/**
+ * @brief Creates the CSV file the diagnostics are written to
+ *
+ * In benchmark mode the file is placed next to the benchmark CSV and named after it.
+ *
+ * @param benchmarkLogFileName path of the benchmark CSV file or an empty string if no benchmark is running
+ * @return std::string path to the diagnostics CSV file
+ */
+std::string initDiagnosticsLogFile(const std::string &benchmarkLogFileName) {
+    std::string fileName;
+    if (benchmarkLogFileName.empty()) {
+        fileName = "benchmarks/" + PerformanceMetricsCollector::getTimeStamp() + "_diagnostics.csv";
+    } else {
+        fileName = benchmarkLogFileName.substr(0, benchmarkLogFileName.rfind(".csv")) + "_diagnostics.csv";
+    }
+
+    std::ofstream logFile;
+    logFile.open(fileName);
+    logFile << "nbody,step,engine,kinetic,potential,total,energy_drift,px,py,pz,lx,ly,lz,com_x,com_y,com_z,min_x,min_y,min_z,max_x,max_y,max_z" << std::endl;
+    logFile.close();
+    return fileName;
+}
+
+static std::map<std::string, double> initialEnergies;//!< Total energy of the first record per engine and body count of the current run
+
+/**
+ * @brief Forgets the initial energies, so that the next record of every engine is the reference of the energy drift
+ *
+ * Has to be called at the start of every run; otherwise a repeated run would be compared with the previous one.
+ */
+void resetDiagnosticsBaseline() {
+    initialEnergies.clear();
+}
+
+/**
+ * @brief Appends one line of diagnostics to the CSV file
+ *
+ * The energy drift is the relative change of the total energy since the first record of the same engine and body count
+ * after resetDiagnosticsBaseline().
+ *
+ * @param logFileName path to the diagnostics CSV file
+ * @param diagnostics diagnostics to write
+ * @param nbody number of bodies
+ * @param step simulation step the diagnostics belong to
+ * @param engine name of the engine which calculated the state ("CPU" or "GPU")
+ */
+void logDiagnostics(const std::string &logFileName, const Diagnostics &diagnostics, std::size_t nbody, std::size_t step, const std::string &engine) {
+    double totalEnergy = diagnostics.kineticEnergy + diagnostics.potentialEnergy;
+    std::string key = engine + std::to_string(nbody);
+    if (initialEnergies.count(key) == 0) {
+        initialEnergies[key] = totalEnergy;
+    }
+    double drift = (totalEnergy - initialEnergies[key]) / std::abs(initialEnergies[key]);
+
+    std::ofstream logFile;
+    logFile.open(logFileName, std::ios_base::app);
+    logFile << nbody << "," << step << "," << engine << ",";
+    logFile << diagnostics.kineticEnergy << "," << diagnostics.potentialEnergy << "," << totalEnergy << "," << drift;
+    for (const double *vector : {diagnostics.momentum, diagnostics.angularMomentum, diagnostics.centerOfMass, diagnostics.boundsMin, diagnostics.boundsMax}) {
+        logFile << "," << vector[0] << "," << vector[1] << "," << vector[2];
+    }
+    logFile << std::endl;
+    logFile.close();
+}
@@ -13,18 +13,27 @@
 #define CL ENABLE_EXCEPTIONS
 
 // clang-format off
+#ifndef NBODY_HEADLESS
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 
 #ifdef __unix__
 #include <GL/glx.h>
+#ifdef NBODY_EGL
+#include <EGL/egl.h>
+#endif
 #elif _WIN32
 #include <GL/GL.h>
 #endif
+#endif
 
 // clang-format on
 #include "../../include/Simulation/GPUCalc.hpp"
 #include "../../include/Data/AbstractData.hpp"
+#include "../../include/Simulation/CompareResults.hpp"
+#include "../../include/Simulation/Transfer.hpp"
+#include "../../include/PerformanceMetrics/PerformanceMetricsCollector.hpp"
+#include "../../include/PerformanceMetrics/Trace.hpp"
 //open cl
 #include "../../include/constants.hpp"
 #include "../../lib/OpenCL/Device.hpp"
@@ -36,9 +45,16 @@
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/mat4x4.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 
-extern GLuint vbo;
+#ifndef NBODY_HEADLESS
+extern GLuint positionRing[3];
+extern GLsync positionRingFences[3];
+extern GLsync positionRingReady[3];
+#endif
 
 extern bool useGPU;
 extern bool useCPU;
@@ -47,29 +63,91 @@ extern AbstractData *dataSet;
 //cl externs
 extern cl::Kernel kernel;
 extern cl::Kernel updateKernel;
+extern cl::Kernel gatherKernel;
+extern cl::Kernel diagnosticsKernel;
 extern cl::CommandQueue queue;
 extern cl::Context context;
 extern cl::Buffer d_pos;
 extern cl::Buffer d_vel;
 extern cl::Buffer d_masses;
+extern cl::Buffer d_sampleIndices;
+extern cl::Buffer d_samplePositions;
+extern cl::Buffer d_diagnostics;
 
 extern int wgSize;
 // cl::Event event;
-extern std::vector<cl::Memory> mem_object;
 extern int wgSize;
 extern std::string kernelFile;
 extern std::string kernelInputPath;
+extern std::string gpuName;
+extern int clPlatformIndex;
+extern int clDeviceIndex;
+extern cl_device_type clDeviceType;
+extern bool glInterop;
+extern bool threadedSimulation;
 cl::Device device;
 std::vector<std::size_t> maxWorkItems;
 std::vector<std::size_t> maxWorkG;
 cl::NDRange workGroupRange;
 cl::NDRange overallItemRange;
 
-extern std::vector<float3> h_pos;
+extern PerformanceMetricsCollector *performanceMetricsCollector;
+extern size_t validationInterval;
+extern size_t validationSampleSize;
+extern std::vector<int> validationIndices;
+extern uint64_t validationSeed;
+
+const std::size_t nrDiagnosticQuantities = 18;//!< Number of reduced quantities, must match NR_QUANTITIES in diagnostics.cl
+std::size_t diagnosticsRealSize = sizeof(float);//!< Size of the floating point type used by the diagnostics kernel (double if the device supports it)
+
+PinnedHostBuffer h_stagingPos;//!< page-locked staging memory for position transfers in CPUGPU mode
+PinnedHostBuffer h_stagingVel;//!< page-locked staging memory for velocity transfers in CPUGPU mode
+std::vector<cl::Buffer> d_positionRing;//!< Shared vertex buffers the positions are published to (see isPublishedToRing())
 
-#ifdef ENABLE_SIMD
-float *tmpBuffer;
+/**
+ * @brief clCreateEventFromGLsyncKHR of cl_khr_gl_event, which is looked up at runtime because it is an extension
+ */
+typedef cl_event(CL_API_CALL *CreateEventFromGLsync)(cl_context context, cl_GLsync sync, cl_int *errcode_ret);
+static CreateEventFromGLsync createEventFromGLsync = nullptr;//!< nullptr if the device doesn't support cl_khr_gl_event
+static std::vector<cl::Event> pendingPublishEvents;           //!< Acquire and release of the last publish which haven't been waited for yet
+
+/**
+ * @brief Whether the GPU result is published by copying it into one of the shared vertex buffers of positionRing
+ *
+ * The kernels always work on their own buffer, so OpenGL can draw the previous state while they run. In CPUGPU mode
+ * the CPU result is rendered, without a window (nbody_bench) there is no OpenGL at all, and devices which can't share
+ * buffers with OpenGL (e.g. CPU runtimes) copy the result through the host (see isRenderedFromHost()).
+ */
+bool isPublishedToRing() {
+#ifdef NBODY_HEADLESS
+    return false;
+#else
+    return glInterop && !useCPU;
+#endif
+}
+
+/**
+ * @brief Whether OpenCL can wait for the fence of a draw call itself (cl_khr_gl_event)
+ *
+ * Otherwise the render loop has to wait on the host until the draw calls reading a vertex buffer have finished before
+ * the buffer is handed back to publishPositionsGPU().
+ */
+bool hasGLEventSharing() {
+    return createEventFromGLsync != nullptr;
+}
+
+/**
+ * @brief Whether the GPU result has to be read back and uploaded to the vertex buffer to be rendered
+ *
+ * This is the case if only the GPU simulates but its context doesn't share buffers with OpenGL.
+ */
+bool isRenderedFromHost() {
+#ifdef NBODY_HEADLESS
+    return false;
+#else
+    return !glInterop && !useCPU;
 #endif
+}
 
 /**
  * @brief compiles the chosen kernels
@@ -84,44 +162,209 @@ void compileKernel(const std::vector<cl::Device> &devices) {
     cl::Program updateProg = OpenCL::loadProgramSource(context, kernelInputPath + "updateKernel.cl");
     OpenCL::buildProgram(updateProg, devices);
     updateKernel = cl::Kernel(updateProg, "updateKernel");
+
+    cl::Program gatherProg = OpenCL::loadProgramSource(context, kernelInputPath + "gatherKernel.cl");
+    OpenCL::buildProgram(gatherProg, devices);
+    gatherKernel = cl::Kernel(gatherProg, "gatherKernel");
+
+    // the diagnostics kernel accumulates in double precision whenever the device supports it
+    cl::Program diagnosticsProg = OpenCL::loadProgramSource(context, kernelInputPath + "diagnostics.cl");
+    OpenCL::buildProgram(diagnosticsProg, devices);
+    diagnosticsKernel = cl::Kernel(diagnosticsProg, "diagnosticsKernel");
+    bool fp64 = devices[0].getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos;
+    diagnosticsRealSize = fp64 ? sizeof(double) : sizeof(float);
+}
+
+/**
+ * @brief Converts the value of --DeviceType into an OpenCL device type
+ *
+ * @param type cpu, gpu, accelerator or all
+ * @return cl_device_type the device type
+ */
+cl_device_type parseDeviceType(const std::string &type) {
+    if (type == "cpu")
+        return CL_DEVICE_TYPE_CPU;
+    if (type == "gpu")
+        return CL_DEVICE_TYPE_GPU;
+    if (type == "accelerator")
+        return CL_DEVICE_TYPE_ACCELERATOR;
+    if (type == "all")
+        return CL_DEVICE_TYPE_ALL;
+    throw std::invalid_argument("Invalid device type given; must be 'cpu', 'gpu', 'accelerator' or 'all'");
+}
+
+/**
+ * @brief Returns the devices of the given type on a platform
+ *
+ * @param platform the platform
+ * @param type device type
+ * @return std::vector<cl::Device> devices (empty if there is none)
+ */
+static std::vector<cl::Device> getDevices(const cl::Platform &platform, cl_device_type type) {
+    std::vector<cl::Device> devices;
+    try {
+        platform.getDevices(type, &devices);
+    } catch (OpenCL::Error &e) {
+        // CL_DEVICE_NOT_FOUND
+        devices.clear();
+    }
+    return devices;
+}
+
+/**
+ * @brief Prints all OpenCL platforms and devices with the indices used by --Platform and --DeviceIndex
+ *
+ * @param stream the output stream
+ */
+void listOpenClDevices(std::ostream &stream) {
+    std::vector<cl::Platform> platforms;
+    try {
+        cl::Platform::get(&platforms);
+    } catch (OpenCL::Error &e) {
+        platforms.clear();
+    }
+    if (platforms.empty()) {
+        stream << "No OpenCL platform found" << std::endl;
+        return;
+    }
+    for (std::size_t p = 0; p < platforms.size(); ++p) {
+        stream << "Platform " << p << ": " << platforms[p].getInfo<CL_PLATFORM_NAME>() << " (" << platforms[p].getInfo<CL_PLATFORM_VERSION>() << ")" << std::endl;
+        std::vector<cl::Device> devices = getDevices(platforms[p], CL_DEVICE_TYPE_ALL);
+        for (std::size_t d = 0; d < devices.size(); ++d) {
+            cl_device_type type = devices[d].getInfo<CL_DEVICE_TYPE>();
+            std::string typeName = (type & CL_DEVICE_TYPE_GPU) ? "gpu" : (type & CL_DEVICE_TYPE_CPU) ? "cpu" : (type & CL_DEVICE_TYPE_ACCELERATOR) ? "accelerator" : "other";
+            bool sharing = devices[d].getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_gl_sharing") != std::string::npos;
+            stream << "  Device " << d << ": " << devices[d].getInfo<CL_DEVICE_NAME>() << " [" << typeName << "], "
+                   << devices[d].getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() << " compute units, "
+                   << devices[d].getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / (1024 * 1024) << " MiB"
+                   << (sharing ? ", OpenGL sharing" : "") << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Selects the device given by --Platform, --DeviceType and --DeviceIndex
+ *
+ * Without a device type GPUs are preferred; if no platform has one, any device is taken (e.g. the PoCL CPU device).
+ * The device index is the one printed by --ListDevices, i.e. it counts all devices of the selected platform (the first
+ * platform if none is selected); the device type is then only checked.
+ *
+ * @param platform receives the platform of the device
+ * @return cl::Device the selected device
+ */
+static cl::Device selectDevice(cl::Platform &platform) {
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+    if (platforms.empty())
+        throw OpenCL::Error(CL_DEVICE_NOT_FOUND, "no OpenCL platform");
+    if (clPlatformIndex >= 0) {
+        if ((std::size_t) clPlatformIndex >= platforms.size())
+            throw OpenCL::Error(CL_INVALID_VALUE, "platform index out of range (see --ListDevices)");
+        platforms = std::vector<cl::Platform>{platforms[clPlatformIndex]};
+    }
+
+    if (clDeviceIndex >= 0) {
+        std::vector<cl::Device> devices = getDevices(platforms[0], CL_DEVICE_TYPE_ALL);
+        if ((std::size_t) clDeviceIndex >= devices.size())
+            throw OpenCL::Error(CL_INVALID_VALUE, "device index out of range (see --ListDevices)");
+        if (clDeviceType != 0 && (devices[clDeviceIndex].getInfo<CL_DEVICE_TYPE>() & clDeviceType) == 0)
+            throw OpenCL::Error(CL_DEVICE_NOT_FOUND, "the selected device is not of the requested type");
+        platform = platforms[0];
+        return devices[clDeviceIndex];
+    }
+
+    std::vector<cl_device_type> types;
+    if (clDeviceType != 0) {
+        types.push_back(clDeviceType);
+    } else {
+        types.push_back(CL_DEVICE_TYPE_GPU);
+        types.push_back(CL_DEVICE_TYPE_ALL);
+    }
+    for (cl_device_type type : types) {
+        for (const cl::Platform &p : platforms) {
+            std::vector<cl::Device> devices = getDevices(p, type);
+            if (!devices.empty()) {
+                platform = p;
+                return devices[0];
+            }
+        }
+    }
+    throw OpenCL::Error(CL_DEVICE_NOT_FOUND, "no OpenCL device of the requested type");
 }
 
 /**
  * @brief inits open cl parameters, context, device, queue
- * 
+ *
+ * The context shares the position buffer with OpenGL if there is a current OpenGL context and the device supports
+ * cl_khr_gl_sharing for it; otherwise a context without interop is created and the positions are copied through
+ * host memory for rendering.
  */
 void openClInit() {
     //**********************
     // OpenCL initialization
     //**********************
-    cl_uint num_platforms;
-    clGetPlatformIDs(0, NULL, &num_platforms);
-    cl_platform_id *platforms = new cl_platform_id[sizeof(cl_platform_id) * num_platforms];
-    clGetPlatformIDs(num_platforms, platforms, NULL);
+    cl::Platform platform;
+    device = selectDevice(platform);
+    std::vector<cl::Device> devices;
+    devices.push_back(device);
+
+    glInterop = false;
+    createEventFromGLsync = nullptr;
+#ifndef NBODY_HEADLESS
 #ifdef __unix__
-    cl_context_properties properties[] = {
-            CL_GL_CONTEXT_KHR, (cl_context_properties) glXGetCurrentContext(),
-            CL_GLX_DISPLAY_KHR, (cl_context_properties) glXGetCurrentDisplay(),
-            CL_CONTEXT_PLATFORM, (cl_context_properties) platforms[0],
-            0};
+    bool glContext = glXGetCurrentContext() != nullptr;
+#ifdef NBODY_EGL
+    // offscreen rendering uses an EGL context instead of GLX
+    bool eglContext = eglGetCurrentContext() != EGL_NO_CONTEXT;
+    glContext = glContext || eglContext;
+#endif
 #elif _WIN32
-    cl_context_properties properties[] = {
-            CL_GL_CONTEXT_KHR, (cl_context_properties) wglGetCurrentContext(),
-            CL_WGL_HDC_KHR, (cl_context_properties) wglGetCurrentDC(),
-            CL_CONTEXT_PLATFORM, (cl_context_properties) platforms[0],
-            0};
+    bool glContext = wglGetCurrentContext() != nullptr;
 #endif
-    context = cl::Context(CL_DEVICE_TYPE_GPU, properties);
-
-    int deviceNr = DEFAULT_OPENCL_DEVICE;
-    std::cout << "Using device " << deviceNr << " / " << context.getInfo<CL_CONTEXT_DEVICES>().size() << std::endl;
-    assert(deviceNr > 0);
-    assert((size_t) deviceNr <= context.getInfo<CL_CONTEXT_DEVICES>().size());
-    device = context.getInfo<CL_CONTEXT_DEVICES>()[deviceNr - 1];
-
+    bool sharing = device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_gl_sharing") != std::string::npos;
+    if (glContext && sharing) {
+#ifdef __unix__
+        cl_context_properties properties[] = {
+                CL_GL_CONTEXT_KHR, (cl_context_properties) glXGetCurrentContext(),
+                CL_GLX_DISPLAY_KHR, (cl_context_properties) glXGetCurrentDisplay(),
+                CL_CONTEXT_PLATFORM, (cl_context_properties) platform(),
+                0};
+#ifdef NBODY_EGL
+        if (eglContext) {
+            properties[1] = (cl_context_properties) eglGetCurrentContext();
+            properties[2] = CL_EGL_DISPLAY_KHR;
+            properties[3] = (cl_context_properties) eglGetCurrentDisplay();
+        }
+#endif
+#elif _WIN32
+        cl_context_properties properties[] = {
+                CL_GL_CONTEXT_KHR, (cl_context_properties) wglGetCurrentContext(),
+                CL_WGL_HDC_KHR, (cl_context_properties) wglGetCurrentDC(),
+                CL_CONTEXT_PLATFORM, (cl_context_properties) platform(),
+                0};
+#endif
+        try {
+            context = cl::Context(devices, properties);
+            glInterop = true;
+            if (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_gl_event") != std::string::npos) {
+                createEventFromGLsync = reinterpret_cast<CreateEventFromGLsync>(clGetExtensionFunctionAddressForPlatform(platform(), "clCreateEventFromGLsyncKHR"));
+            }
+        } catch (OpenCL::Error &e) {
+            // e.g. the device doesn't drive the display the OpenGL context belongs to
+            std::cerr << "OpenCL/OpenGL sharing is not available for this device (" << e.what() << ")" << std::endl;
+        }
+    }
+#endif
+    if (!glInterop) {
+        cl_context_properties properties[] = {
+                CL_CONTEXT_PLATFORM, (cl_context_properties) platform(),
+                0};
+        context = cl::Context(devices, properties);
+    }
 
-    std::vector<cl::Device> devices;
-    devices.push_back(device);
+    std::cout << "Using device " << device.getInfo<CL_DEVICE_NAME>() << " on platform " << platform.getInfo<CL_PLATFORM_NAME>()
+              << (glInterop ? " (sharing buffers with OpenGL)" : " (without OpenGL sharing)") << std::endl;
+    gpuName = device.getInfo<CL_DEVICE_NAME>();
     OpenCL::printDeviceInfo(std::cout, device);
     compileKernel(devices);
 
@@ -129,19 +372,6 @@ void openClInit() {
 
     // Create a command queue
     queue = cl::CommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE);
-
-    if (useCPU && useGPU) {
-        d_pos = cl::Buffer(context, CL_MEM_READ_WRITE, dataSet->getBytesCount());
-        h_pos.resize(dataSet->getSize());
-    } else {
-        d_pos = cl::BufferGL(context, CL_MEM_READ_WRITE, vbo);
-    }
-    mem_object.clear();
-    mem_object.push_back(d_pos);
-#ifdef ENABLE_SIMD
-    tmpBuffer = new float[3 * dataSet->getSize() * sizeof(float)];
-#endif
-    delete[] platforms;
 }
 
 /**
@@ -169,6 +399,22 @@ void gpuInit() {
     *First we write the important buffers, position, velocioty and masses to GPU buffers
     */
     int floatsize = sizeof(float);
+    d_pos = cl::Buffer(context, CL_MEM_READ_WRITE, dataSet->getBytesCount());
+    if (useCPU && useGPU) {
+        h_stagingPos.allocate(context, queue, dataSet->getBytesCount());
+        h_stagingVel.allocate(context, queue, dataSet->getBytesCount());
+    } else if (isRenderedFromHost()) {
+        h_stagingPos.allocate(context, queue, dataSet->getBytesCount());
+    }
+    d_positionRing.clear();
+    pendingPublishEvents.clear();
+#ifndef NBODY_HEADLESS
+    if (isPublishedToRing()) {
+        for (GLuint buffer : positionRing)
+            d_positionRing.push_back(cl::BufferGL(context, CL_MEM_WRITE_ONLY, buffer));
+    }
+#endif
+
     // masses, acc, pos and vel are needed, where as the later two will be copied from GL directly and don't need init here
     d_masses = cl::Buffer(context, CL_MEM_READ_ONLY, dataSet->getSize() * floatsize);
     queue.enqueueWriteBuffer(d_masses, true, 0, dataSet->getSize() * floatsize, massInit().data());
@@ -177,6 +423,20 @@ void gpuInit() {
     d_vel = cl::Buffer(context, CL_MEM_READ_WRITE, flatSize);
     queue.enqueueWriteBuffer(d_vel, true, 0, flatSize, dataSet->getFlatVelocities().data());
 
+    queue.enqueueWriteBuffer(d_pos, true, 0, dataSet->getBytesCount(), dataSet->getFlatPositions().data());
+    if (useCPU && useGPU && validationInterval > 0) {
+        validationIndices = selectValidationSample(dataSet->getSize(), validationSampleSize, validationSeed);
+        cl_int sampleSize = validationIndices.size();
+        d_sampleIndices = cl::Buffer(context, CL_MEM_READ_ONLY, sampleSize * sizeof(int));
+        queue.enqueueWriteBuffer(d_sampleIndices, true, 0, sampleSize * sizeof(int), validationIndices.data());
+        d_samplePositions = cl::Buffer(context, CL_MEM_WRITE_ONLY, 3 * sampleSize * floatsize);
+
+        gatherKernel.setArg<cl::Buffer>(0, d_pos);
+        gatherKernel.setArg<cl::Buffer>(1, d_sampleIndices);
+        gatherKernel.setArg<cl::Buffer>(2, d_samplePositions);
+        gatherKernel.setArg(3, sampleSize);
+    }
+
     // gets the maximum work items allowed in a group for the device given
     maxWorkItems = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>();
     int workitems = maxWorkItems[0] / 16;
@@ -202,6 +462,20 @@ void gpuInit() {
     workGroupRange = cl::NDRange(workitems);
 
 
+    /*
+    * arguments for the diagnostics kernel, which writes one partial result per quantity and work group
+    */
+    std::size_t nrGroups = roundedDimSize;
+    d_diagnostics = cl::Buffer(context, CL_MEM_WRITE_ONLY, nrGroups * nrDiagnosticQuantities * diagnosticsRealSize);
+    diagnosticsKernel.setArg<cl::Buffer>(0, d_pos);
+    diagnosticsKernel.setArg<cl::Buffer>(1, d_vel);
+    diagnosticsKernel.setArg<cl::Buffer>(2, d_masses);
+    diagnosticsKernel.setArg(3, nrBodies);
+    diagnosticsKernel.setArg(4, -6.67e-11f);
+    diagnosticsKernel.setArg(5, (float) (1.0 / dataSet->getMaxMass()));
+    diagnosticsKernel.setArg<cl::Buffer>(6, d_diagnostics);
+    diagnosticsKernel.setArg(7, cl::Local(workitems * diagnosticsRealSize));
+
     /*
     * arguments for update kernel (all kernels use the same)
     */
@@ -233,56 +507,309 @@ void gpuInit() {
         kernel.setArg(7, cl::Local(floatsFitting));
     }
     queue.finish();
+    calibrateDeviceClock();
+}
+
+/**
+ * @brief Releases all buffers which depend on the data set
+ *
+ * Context, queue and compiled kernels are kept, so gpuInit() can be called for the next data set.
+ * The shared vertex buffers have to be released before OpenGL deletes them.
+ */
+void gpuRelease() {
+    queue.finish();
+    d_positionRing.clear();
+    pendingPublishEvents.clear();
+    d_pos = cl::Buffer();
+    d_vel = cl::Buffer();
+    d_masses = cl::Buffer();
+    d_sampleIndices = cl::Buffer();
+    d_samplePositions = cl::Buffer();
+    d_diagnostics = cl::Buffer();
+    h_stagingPos.release();
+    h_stagingVel.release();
+}
+
+/**
+ * @brief Measures the attained peak performance of the OpenCL device with the kernels in peak.cl.
+ *
+ * Both kernels are timed with profiling events and the best of three runs is used.
+ * The theoretical limits (compute units and clock) are printed for comparison.
+ *
+ * @return PeakPerformance GFLOP/s and GB/s of the device
+ */
+PeakPerformance measureDevicePeak() {
+    cl::Program peakProg = OpenCL::loadProgramSource(context, kernelInputPath + "peak.cl");
+    OpenCL::buildProgram(peakProg, std::vector<cl::Device>{device});
+    cl::Kernel flopsKernel(peakProg, "peakFlopsKernel");
+    cl::Kernel copyKernel(peakProg, "peakCopyKernel");
+
+    cl_uint computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    cl_uint clock = device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
+    std::cout << "Device: " << computeUnits << " compute units at " << clock << " MHz" << std::endl;
+
+    // enough work groups to saturate every compute unit several times
+    std::size_t groupSize = std::min<std::size_t>(device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>(), 256);
+    std::size_t flopsItems = groupSize * computeUnits * 16;
+    const cl_int iterations = 4096;
+    cl::Buffer d_result(context, CL_MEM_WRITE_ONLY, flopsItems * sizeof(float));
+    flopsKernel.setArg<cl::Buffer>(0, d_result);
+    flopsKernel.setArg(1, 0.999f);
+    flopsKernel.setArg(2, 0.001f);
+    flopsKernel.setArg(3, iterations);
+
+    // 64 MiB per buffer, far beyond any device cache
+    std::size_t copyItems = (std::size_t(64) << 20) / (4 * sizeof(float));
+    cl::Buffer d_source(context, CL_MEM_READ_ONLY, copyItems * 4 * sizeof(float));
+    cl::Buffer d_destination(context, CL_MEM_WRITE_ONLY, copyItems * 4 * sizeof(float));
+    copyKernel.setArg<cl::Buffer>(0, d_source);
+    copyKernel.setArg<cl::Buffer>(1, d_destination);
+
+    PeakPerformance peak;
+    for (int run = 0; run < 3; ++run) {
+        cl::Event flopsEvent;
+        queue.enqueueNDRangeKernel(flopsKernel, cl::NullRange, cl::NDRange(flopsItems), cl::NDRange(groupSize), NULL, &flopsEvent);
+        cl::Event copyEvent;
+        queue.enqueueNDRangeKernel(copyKernel, cl::NullRange, cl::NDRange(copyItems), cl::NullRange, NULL, &copyEvent);
+        queue.finish();
+        double flopsSeconds = OpenCL::getElapsedTime(flopsEvent).getSeconds();
+        double copySeconds = OpenCL::getElapsedTime(copyEvent).getSeconds();
+        peak.gflops = std::max(peak.gflops, 16.0 * iterations * flopsItems / flopsSeconds * 1e-9);
+        peak.bandwidth = std::max(peak.bandwidth, 2.0 * copyItems * 4 * sizeof(float) / copySeconds * 1e-9);
+    }
+    peak.source = device.getInfo<CL_DEVICE_NAME>();
+    return peak;
+}
+
+Core::TimeSpan lastClockCalibration(0);//!< Host time of the last measurement of the device clock offset
+
+/**
+ * @brief Measures the offset between the device clock of the profiling events and the host clock for the trace
+ *
+ * A tiny blocking write is timed on both clocks; its end on the device is assumed to lie in the middle of the host interval.
+ */
+void calibrateDeviceClock() {
+    if (!Trace::isEnabled())
+        return;
+    cl_int value = 0;
+    cl::Buffer d_calibration(context, CL_MEM_READ_WRITE, sizeof(cl_int));
+    cl::Event event;
+    Core::TimeSpan before = Core::getCurrentTime();
+    queue.enqueueWriteBuffer(d_calibration, true, 0, sizeof(cl_int), &value, nullptr, &event);
+    Core::TimeSpan after = Core::getCurrentTime();
+    int64_t host = (before.getMicroseconds() + after.getMicroseconds()) / 2;
+    int64_t device = static_cast<int64_t>(event.getProfilingInfo<CL_PROFILING_COMMAND_END>() / 1000);
+    Trace::setDeviceClockOffset(host - device);
+    lastClockCalibration = after;
+}
+
+/**
+ * @brief Hands the profiling timestamps of a finished OpenCL command to the performance metrics collector and the trace
+ *
+ * @param phase Phase the command belongs to
+ * @param event Event of the command (the queue must have profiling enabled)
+ */
+void recordEventPhase(Phase phase, const cl::Event &event) {
+    cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+    cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+    performanceMetricsCollector->addPhaseEvent(phase,
+                                               event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>(),
+                                               event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>(),
+                                               start,
+                                               end);
+    Trace::addDeviceZone(PerformanceMetricsCollector::getPhaseName(phase), start, end);
 }
 
 /**
  * @brief gpu rendering methods with OpenGL bridge
  * 
+ * All steps are enqueued back-to-back on the private position buffer; publishPositionsGPU() hands the result to OpenGL.
+ * 
+ * @param steps Number of simulation steps calculated before the result is handed back to OpenGL
  * @returns time need for calculation in seconds
  */
-double simulateGPU() {
-    if (useCPU && useGPU) {
-        queue.enqueueWriteBuffer(d_pos, true, 0, dataSet->getBytesCount(), dataSet->getFlatPositions().data());
-        queue.enqueueWriteBuffer(d_vel, true, 0, dataSet->getBytesCount(), dataSet->getFlatVelocities().data());
-    } else {
-        glFinish();
-        cl_int err = queue.enqueueAcquireGLObjects(&mem_object);
-        queue.finish();
+double simulateGPU(std::size_t steps) {
+    TraceZone zone("simulateGPU", "gpu");
+    // the clocks drift apart slowly, so the offset is measured again every few seconds
+    if (Trace::isEnabled() && (Core::getCurrentTime() - lastClockCalibration).getSeconds() > 5.0) {
+        calibrateDeviceClock();
+    }
+    cl::Event writePosEvent;
+    cl::Event writeVelEvent;
+    bool lockstep = useCPU && useGPU && validationInterval == 0;
+    if (lockstep) {
+        // in lockstep mode the GPU continues from the CPU state of the last step
+        // the state is flattened directly into page-locked memory, so the uploads don't need another copy
+        TraceZone flattenZone("flatten_state", "transfer");
+        dataSet->writeFlatPositions(h_stagingPos.data());
+        dataSet->writeFlatVelocities(h_stagingVel.data());
+        queue.enqueueWriteBuffer(d_pos, false, 0, dataSet->getBytesCount(), h_stagingPos.data(), nullptr, &writePosEvent);
+        queue.enqueueWriteBuffer(d_vel, false, 0, dataSet->getBytesCount(), h_stagingVel.data(), nullptr, &writeVelEvent);
     }
 
-    // launches the kernel to calculate velocities
-    cl::Event event;
-    queue.enqueueNDRangeKernel(kernel, cl::NullRange, overallItemRange, workGroupRange, nullptr, &event);
-    queue.finish();
+    // the queue is in-order, so the kernels of consecutive steps don't need to be synchronized by the host
+    std::vector<cl::Event> events(steps);
+    std::vector<cl::Event> updateEvents(steps);
+    for (std::size_t step = 0; step < steps; ++step) {
+        // launches the kernel to calculate velocities
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, overallItemRange, workGroupRange, nullptr, &events[step]);
 
-    // launces kernel to update positions based on velocities
-    cl::Event updateEvent;
-    queue.enqueueNDRangeKernel(updateKernel, cl::NullRange, overallItemRange, workGroupRange, nullptr, &updateEvent);
-    queue.finish();
+        // launces kernel to update positions based on velocities
+        queue.enqueueNDRangeKernel(updateKernel, cl::NullRange, overallItemRange, workGroupRange, nullptr, &updateEvents[step]);
+    }
+    {
+        TraceZone finishZone("queue_finish", "gpu");
+        queue.finish();
+    }
 
-    Core::TimeSpan calcTime = OpenCL::getElapsedTime(event);
-    Core::TimeSpan updateTime = OpenCL::getElapsedTime(updateEvent);
+    Core::TimeSpan calcTime(0);
+    Core::TimeSpan updateTime(0);
+    for (std::size_t step = 0; step < steps; ++step) {
+        calcTime = calcTime + OpenCL::getElapsedTime(events[step]);
+        updateTime = updateTime + OpenCL::getElapsedTime(updateEvents[step]);
+        recordEventPhase(Phase::FORCE_KERNEL, events[step]);
+        recordEventPhase(Phase::UPDATE_KERNEL, updateEvents[step]);
+    }
 
-    if (useCPU && useGPU) {
-#ifdef ENABLE_SIMD
-        queue.enqueueReadBuffer(d_pos, true, 0, dataSet->getBytesCount(), tmpBuffer);
-        for (std::size_t i = 0; i < dataSet->getSize(); ++i) {
-            h_pos[i].x = tmpBuffer[3 * i];
-            h_pos[i].y = tmpBuffer[3 * i + 1];
-            h_pos[i].z = tmpBuffer[3 * i + 2];
-            h_pos[i].w = EPSILON;
-        }
-#else
-        queue.enqueueReadBuffer(d_pos, true, 0, dataSet->getBytesCount(), h_pos.data());
-#endif
+    if (lockstep) {
+        recordEventPhase(Phase::WRITE_POSITIONS, writePosEvent);
+        recordEventPhase(Phase::WRITE_VELOCITIES, writeVelEvent);
+
+        // the positions are only needed for the comparison, which reads them from the staging memory; the CPU result
+        // is rendered
+        TraceZone readZone("read_positions", "transfer");
+        cl::Event readEvent;
+        queue.enqueueReadBuffer(d_pos, true, 0, dataSet->getBytesCount(), h_stagingPos.data(), nullptr, &readEvent);
+        recordEventPhase(Phase::READ_POSITIONS, readEvent);
+    } else if (isRenderedFromHost()) {
+        // without OpenGL sharing the positions are copied into the data set, from which the vertex buffer is filled
+        TraceZone readZone("read_positions", "transfer");
+        cl::Event readEvent;
+        queue.enqueueReadBuffer(d_pos, true, 0, dataSet->getBytesCount(), h_stagingPos.data(), nullptr, &readEvent);
+        recordEventPhase(Phase::READ_POSITIONS, readEvent);
+        dataSet->readFlatPositions(h_stagingPos.data());
+    }
+    return calcTime.getSeconds() + updateTime.getSeconds();
+}
 
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        void *ptr = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-        memcpy(ptr, h_pos.data(), dataSet->getBytesCount());
-        glUnmapBuffer(GL_ARRAY_BUFFER);
+/**
+ * @brief Copies the current positions into a vertex buffer of positionRing
+ *
+ * Instead of draining the OpenGL pipeline with glFinish(), the acquire waits only for the fence of the draw calls which
+ * read the buffer last (positionRingFences); without cl_khr_gl_event the render loop has already waited for it on the
+ * host. In the render callback the release is turned into an OpenGL sync object (GL_ARB_cl_event) in positionRingReady,
+ * which the draw call waits for on the GPU, so the host doesn't wait for the copy either. The simulation thread has no
+ * OpenGL context and finishes the copy before the slot is published.
+ *
+ * @param slot index of the vertex buffer in positionRing
+ */
+void publishPositionsGPU(unsigned slot) {
+#ifndef NBODY_HEADLESS
+    TraceZone zone("publish_positions", "transfer");
+    // the kernels of the current steps have been finished, so the commands of the last publish are finished as well
+    if (pendingPublishEvents.size() == 2) {
+        recordEventPhase(Phase::GL_ACQUIRE, pendingPublishEvents[0]);
+        recordEventPhase(Phase::GL_RELEASE, pendingPublishEvents[1]);
+    }
+    pendingPublishEvents.clear();
+
+    std::vector<cl::Event> drawn;
+    if (positionRingFences[slot] != nullptr && hasGLEventSharing()) {
+        cl_int error = CL_SUCCESS;
+        cl_event event = createEventFromGLsync(context(), reinterpret_cast<cl_GLsync>(positionRingFences[slot]), &error);
+        if (error == CL_SUCCESS) {
+            drawn.push_back(cl::Event(event));
+        }
+    }
+    std::vector<cl::Memory> target(1, d_positionRing[slot]);
+    cl::Event acquireEvent;
+    cl::Event releaseEvent;
+    queue.enqueueAcquireGLObjects(&target, drawn.empty() ? nullptr : &drawn, &acquireEvent);
+    queue.enqueueCopyBuffer(d_pos, d_positionRing[slot], 0, 0, dataSet->getBytesCount());
+    queue.enqueueReleaseGLObjects(&target, nullptr, &releaseEvent);
+    if (!threadedSimulation && GLEW_ARB_cl_event) {
+        queue.flush();
+        positionRingReady[slot] = glCreateSyncFromCLeventARB(context(), releaseEvent(), 0);
+        pendingPublishEvents = {acquireEvent, releaseEvent};
     } else {
-        queue.enqueueReleaseGLObjects(&mem_object);
         queue.finish();
+        recordEventPhase(Phase::GL_ACQUIRE, acquireEvent);
+        recordEventPhase(Phase::GL_RELEASE, releaseEvent);
     }
-    return calcTime.getSeconds() + updateTime.getSeconds();
-}
\ No newline at end of file
+#endif
+}
+
+/**
+ * @brief Gathers the positions of the validation sample on the GPU and reads them back
+ *
+ * @return std::vector<float> flat positions (stride 3) of the sampled bodies
+ */
+std::vector<float> readValidationSampleGPU() {
+    TraceZone zone("read_validation_sample", "transfer");
+    std::vector<float> samplePositions(3 * validationIndices.size());
+    float dimSize = ((float) validationIndices.size()) / workGroupRange[0];
+    cl::NDRange sampleItemRange(workGroupRange[0] * (std::size_t) std::ceil(dimSize));
+    queue.enqueueNDRangeKernel(gatherKernel, cl::NullRange, sampleItemRange, workGroupRange);
+    queue.enqueueReadBuffer(d_samplePositions, true, 0, samplePositions.size() * sizeof(float), samplePositions.data());
+    return samplePositions;
+}
+
+/**
+ * @brief Copies positions and velocities of the GPU into the data set (e.g. for a snapshot)
+ */
+void downloadStateGPU() {
+    TraceZone zone("download_state", "transfer");
+    std::vector<float> flat(3 * dataSet->getSize());
+    queue.enqueueReadBuffer(d_pos, true, 0, dataSet->getBytesCount(), flat.data());
+    dataSet->readFlatPositions(flat.data());
+    queue.enqueueReadBuffer(d_vel, true, 0, dataSet->getBytesCount(), flat.data());
+    dataSet->readFlatVelocities(flat.data());
+}
+
+/**
+ * @brief Calculates the conservation diagnostics of the GPU state on the device
+ *
+ * Only the partial results of the work groups are read back and summed up on the host.
+ *
+ * @return Diagnostics of the current GPU state
+ */
+Diagnostics computeDiagnosticsGPU() {
+    TraceZone zone("diagnostics_gpu", "gpu");
+    queue.enqueueNDRangeKernel(diagnosticsKernel, cl::NullRange, overallItemRange, workGroupRange);
+    std::size_t nrGroups = overallItemRange[0] / workGroupRange[0];
+    std::vector<unsigned char> partials(nrGroups * nrDiagnosticQuantities * diagnosticsRealSize);
+    queue.enqueueReadBuffer(d_diagnostics, true, 0, partials.size(), partials.data());
+
+    // sums, minima (quantities 12-14) and maxima (quantities 15-17) over all work groups
+    std::vector<double> totals(nrDiagnosticQuantities, 0.0);
+    std::fill(totals.begin() + 12, totals.begin() + 15, std::numeric_limits<double>::infinity());
+    std::fill(totals.begin() + 15, totals.end(), -std::numeric_limits<double>::infinity());
+    for (std::size_t g = 0; g < nrGroups; ++g) {
+        for (std::size_t q = 0; q < nrDiagnosticQuantities; ++q) {
+            std::size_t index = g * nrDiagnosticQuantities + q;
+            double value = diagnosticsRealSize == sizeof(double) ? reinterpret_cast<double *>(partials.data())[index] : reinterpret_cast<float *>(partials.data())[index];
+            if (q < 12) {
+                totals[q] += value;
+            } else if (q < 15) {
+                totals[q] = (std::min)(totals[q], value);
+            } else {
+                totals[q] = (std::max)(totals[q], value);
+            }
+        }
+    }
+
+    // undo the mass scaling of the kernel
+    double massScale = 1.0 / dataSet->getMaxMass();
+    Diagnostics diagnostics;
+    diagnostics.kineticEnergy = totals[0] / massScale;
+    diagnostics.potentialEnergy = totals[1] / (massScale * massScale);
+    diagnostics.totalMass = totals[2] / massScale;
+    for (int k = 0; k < 3; ++k) {
+        diagnostics.momentum[k] = totals[3 + k] / massScale;
+        diagnostics.angularMomentum[k] = totals[6 + k] / massScale;
+        diagnostics.centerOfMass[k] = totals[9 + k] / totals[2];
+        diagnostics.boundsMin[k] = totals[12 + k];
+        diagnostics.boundsMax[k] = totals[15 + k];
+    }
+    return diagnostics;
+}
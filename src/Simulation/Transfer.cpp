@@ -0,0 +1,49 @@
+/**
+* @file Transfer.cpp
+* @author Kay Scheerer, Fabian Hauck, Timo Schrader
+* @brief Contains a page-locked host staging buffer for transfers between host and OpenCL device
+* @version 1
+* @date 2022-02-07
+*
+* @copyright Copyright (c) 2022
+*
+*/
+
+#include "../../include/Simulation/Transfer.hpp"
+
+/**
+ * @brief Allocates the staging buffer and maps it into the host address space
+ *
+ * A previously allocated buffer is released first.
+ *
+ * @param context OpenCL context the buffer belongs to
+ * @param queue Command queue used for mapping and unmapping
+ * @param bytes Size of the buffer in bytes
+ */
+void PinnedHostBuffer::allocate(const cl::Context &context, const cl::CommandQueue &queue, std::size_t bytes) {
+    release();
+    this->buffer = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, bytes);
+    this->mappingQueue = queue;
+    this->hostPtr = static_cast<float *>(queue.enqueueMapBuffer(this->buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, bytes));
+    this->bytes = bytes;
+}
+
+/**
+ * @brief Unmaps and frees the staging buffer
+ */
+void PinnedHostBuffer::release() {
+    if (this->hostPtr != nullptr) {
+        this->mappingQueue.enqueueUnmapMemObject(this->buffer, this->hostPtr);
+        this->mappingQueue.finish();
+        this->hostPtr = nullptr;
+        this->bytes = 0;
+    }
+}
+
+float *PinnedHostBuffer::data() const {
+    return this->hostPtr;
+}
+
+std::size_t PinnedHostBuffer::size() const {
+    return this->bytes;
+}
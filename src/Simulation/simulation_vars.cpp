@@ -0,0 +1,72 @@
+/**
+ * @file simulation_vars.cpp
+ * @author Kay Scheerer, Fabian Hauck, Timo Schrader
+ * @brief Contains global variables of the simulation engines, which are shared by the renderer and nbody_bench
+ * @version 1
+ * @date 2021-12-21
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+// clang-format off
+#include "../../include/Data/AbstractData.hpp"
+#include "../../include/Data/TrajectoryRecorder.hpp"
+#include "../../include/PerformanceMetrics/PerformanceMetricsCollector.hpp"
+#include "../../include/PerformanceMetrics/Roofline.hpp"
+#include "../../lib/OpenCL/Device.hpp"
+// clang-format on
+
+bool useGPU = false;//!< Whether to use GPU for simulation
+bool useCPU = false;//!< Whether to use CPU for simulation
+
+AbstractData *dataSet;//!< Pointer for dataset object which can be specified during runtime
+
+//cl vars
+cl::Kernel kernel;                  //!< kernel to calculate new values for all bodies
+cl::Kernel updateKernel;            //!< kernel to update positions
+cl::Kernel gatherKernel;            //!< kernel to gather the positions of the validation sample
+cl::Kernel diagnosticsKernel;       //!< kernel to reduce energies, momenta, center of mass and bounding box
+cl::CommandQueue queue;             //!< queue to run commands on GPU
+cl::Context context;                //!< the cl GPU context
+std::string kernelFile = "nbody.cl";//!< kernel file to use
+std::string kernelInputPath;        //!< path to kernel folder
+cl::Buffer d_pos;                   //!< a buffer with flattened positions of all bodies
+cl::Buffer d_vel;                  //!< a buffer with flattened velocities of all bodies
+cl::Buffer d_masses;               //!< a buffer with masses of all bodies
+cl::Buffer d_sampleIndices;        //!< indices of the bodies which are compared in the validation mode
+cl::Buffer d_samplePositions;      //!< gathered positions of the validation sample
+cl::Buffer d_diagnostics;          //!< partial results of the diagnostics kernel (one set per work group)
+int wgSize = 0;                    //!< size of the workgroup
+
+// OpenCL device selection
+int clPlatformIndex = -1;         //!< Platform given with --Platform; -1 searches all platforms
+int clDeviceIndex = -1;           //!< Device given with --DeviceIndex (counted within the selected platforms and type); -1 takes the first
+cl_device_type clDeviceType = 0;  //!< Device type given with --DeviceType; 0 prefers GPUs and falls back to any device
+bool glInterop = false;           //!< Whether the OpenCL context shares the position buffer with OpenGL
+bool threadedSimulation = false;  //!< Whether the simulation runs on its own thread instead of inside the render callback
+
+// Validation variables (only used with --Device CPUGPU)
+size_t validationInterval = 0;     //!< Number of steps between two comparisons; 0 keeps CPU and GPU in lockstep and compares every step
+size_t validationSampleSize = 0;   //!< Number of randomly chosen bodies that are compared; 0 compares all bodies
+std::vector<int> validationIndices;//!< Indices of the bodies that are compared in the validation mode
+uint64_t validationSeed = 1;       //!< Seed of the random validation sample, so that a run can be repeated with the same bodies
+size_t simulationStep = 0;         //!< Number of simulation steps that have been calculated so far
+
+// Checkpoint variables
+size_t checkpointInterval = 0;                    //!< Number of steps between two snapshots; 0 disables them
+std::string checkpointFileName = "checkpoint.nbody";//!< Snapshot file which is replaced at every checkpoint
+size_t restartStep = 0;                           //!< Step of the snapshot the simulation was restarted from
+
+// Trajectory variables
+size_t trajectoryInterval = 0;                    //!< Number of steps between two recorded frames; 0 disables the recording
+TrajectoryRecorder *trajectoryRecorder = nullptr; //!< Streams the frames to the trajectory file
+
+// Diagnostics variables
+size_t diagnosticsInterval = 0;   //!< Number of steps between two diagnostics; 0 disables them
+std::string diagnosticsLogFileName;//!< CSV file the diagnostics are written to
+
+// Performance variables
+std::string gpuName;
+PerformanceMetricsCollector *performanceMetricsCollector;
+PeakPerformance peakPerformance;//!< Attained peak of the device that calculates the benchmarked steps
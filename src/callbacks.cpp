@@ -19,6 +19,9 @@ extern glm::vec3 upVector;
 extern float zoomFactor;
 extern bool copyMatricesToGPU;
 extern bool automaticCameraRotation;
+extern bool cullingEnabled;
+extern bool densityRendering;
+extern bool trailsEnabled;
 bool isFullScreen = false;
 
 /**
@@ -41,6 +44,15 @@ void glKeyboardCallback(unsigned char key, int x, int y) {
                 automaticCameraRotation = true;
             }
             break;
+        case 'c':
+            cullingEnabled = !cullingEnabled;
+            break;
+        case 'd':
+            densityRendering = !densityRendering;
+            break;
+        case 't':
+            trailsEnabled = !trailsEnabled;
+            break;
         case 'f':
             if (!isFullScreen) {
                 glutFullScreen();
@@ -1,7 +1,7 @@
 /**
  * @file global_vars.cpp
  * @author Kay Scheerer, Fabian Hauck, Timo Schrader
- * @brief Contains global variables used throughout the program
+ * @brief Contains global variables of the renderer and the benchmark mode
  * @version 1
  * @date 2021-12-21
  * 
@@ -12,18 +12,15 @@
 // clang-format off
 #include "../include/Data/AbstractData.hpp"
 #include "../include/glm/mat4x4.hpp"
+#include "../include/Render/FrameExporter.hpp"
+#include "../include/constants.hpp"
 #include "PerformanceMetrics/PerformanceMetricsCollector.hpp"
 #include <GL/glew.h>
-#include <../lib/OpenCL/Device.hpp>
 // clang-format on
 
-bool useGPU = false;//!< Whether to use GPU for simulation
-bool useCPU = false;//!< Whether to use CPU for simulation
-
 int mainWindow;               //!< Handle of the main window which all content is being rendered to
 GLuint vao;                   //!< Vertex array object which combines all vertex buffer objects
 GLuint shaderProgram;         //!< Handle of the shader program
-AbstractData *dataSet;        //!< Pointer for dataset object which can be specified during runtime
 std::size_t numRenderElements;//!< Number of bodies to be rendered
 
 int M_model_loc = 0;     //!< Location of the model matrix in the shader program
@@ -46,20 +43,11 @@ glm::vec3 upVector = glm::normalize(glm::cross(directionVector, rightVector)); /
 float zoomFactor = 0.3f;             //<! Determines the zoom factor of the rendered screne; changed when scrolling
 bool copyMatricesToGPU = false;      //!< If any of the matrices has been altered, they will all be copied again to the GPU in the render loop
 bool automaticCameraRotation = false;//!< Whether to rotate the camera automatically at each timestep
+bool cullingEnabled = true;          //!< Whether the bodies are culled and merged per screen cell on the GPU before they are drawn
+bool densityRendering = false;       //!< Whether the bodies are drawn as additive density splats instead of point sprites
+bool trailsEnabled = false;          //!< Whether the trails of the bodies are drawn
+size_t trailLength = 32;             //!< Number of positions per trail (the newest one included)
 
-//cl vars
-cl::Kernel kernel;                  //!< kernel to calculate new values for all bodies
-cl::Kernel updateKernel;            //!< kernel to update positions
-cl::CommandQueue queue;             //!< queue to run commands on GPU
-cl::Context context;                //!< the cl GPU context
-std::string kernelFile = "nbody.cl";//!< kernel file to use
-std::string kernelInputPath;        //!< path to kernel folder
-cl::Buffer d_pos;                   //!< a buffer with flattened positions of all bodies
-std::vector<float3> h_pos;         //!< Buffer for float3 positions on the host side
-cl::Buffer d_vel;                  //!< a buffer with flattened velocities of all bodies
-cl::Buffer d_masses;               //!< a buffer with masses of all bodies
-std::vector<cl::Memory> mem_object;//!< mem object to share with OpenGL lib
-int wgSize = 0;                    //!< size of the workgroup
 inline const std::vector<float> coordinateSystemLines = {
         0.0f,
         0.0f,
@@ -101,10 +89,22 @@ inline const std::vector<float> lineColors = {
         1.0f,
 };//!< Colors of the coord system axes
 
+// Offscreen variables
+bool offscreenRendering = false;       //!< Whether the frames are rendered into an EGL pbuffer instead of a window
+unsigned frameWidth = SCREEN_WIDTH;    //!< Width of the window or the offscreen frames in pixels
+unsigned frameHeight = SCREEN_HEIGHT;  //!< Height of the window or the offscreen frames in pixels
+size_t frameLimit = 0;                 //!< Number of frames after which the render loop is left (0 for no limit)
+bool exitRenderLoop = false;           //!< Ends the offscreen render loop or the current benchmark run
+FrameExporter *frameExporter = nullptr;//!< Exports the rendered frames if set
+
+// Substep variables
+size_t stepsPerFrame = 1;          //!< Number of simulation steps calculated per rendered frame
+bool adaptiveStepsPerFrame = false;//!< Whether the number of steps per frame is adapted to reach targetFrameRate
+double targetFrameRate = 60.0;     //!< Frame rate that is aimed at in the adaptive mode
+
 // Benchmark variables
 std::vector<size_t> bodyNumbers{7, 119, 1015, 10231, 20471, 102391, 204791, 409591};
-size_t benchmarkLength = 10;
-size_t benchmarkWarmUp = 120;
-std::string gpuName;
+double benchmarkTargetWidth = 0.02;//!< Target half width of the 95 % confidence interval of the step time relative to its mean
+double benchmarkTimeBudget = 60.0; //!< Maximum duration of a benchmark run in seconds
+size_t benchmarkRepetitions = 1;//!< Number of runs per body count
 BenchmarkMode benchmark;
-PerformanceMetricsCollector *performanceMetricsCollector;
@@ -18,17 +18,29 @@
 #include <GL/GL.h>
 #endif
 // clang-format on
+#include "../../include/Data/CsvDataSet.hpp"
+#include "../../include/Data/ModelDataSet.hpp"
+#include "../../include/Data/SnapshotDataSet.hpp"
+#include "../../include/Data/TrajectoryRecorder.hpp"
 #include "../../include/Data/WikipediaDataSet.hpp"
 #include "PerformanceMetrics/PerformanceMetricsCollector.hpp"
+#include "PerformanceMetrics/Sweep.hpp"
+#include "PerformanceMetrics/PerfCounters.hpp"
+#include "PerformanceMetrics/Trace.hpp"
 #include <boost/program_options.hpp>
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <random>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 #include <string>
 
+#include <Render/FrameExporter.hpp>
+#include <Render/Offscreen.hpp>
 #include <Render/render.hpp>
+#include <Simulation/Diagnostics.hpp>
 #include <Simulation/GPUCalc.hpp>
 
 extern bool useGPU;
@@ -36,12 +48,55 @@ extern bool useCPU;
 extern AbstractData *dataSet;
 extern std::string kernelFile;
 extern std::string kernelInputPath;
+extern int clPlatformIndex;
+extern int clDeviceIndex;
+extern cl_device_type clDeviceType;
+extern size_t validationInterval;
+extern size_t validationSampleSize;
+extern uint64_t validationSeed;
+extern size_t stepsPerFrame;
+extern bool adaptiveStepsPerFrame;
+extern double targetFrameRate;
+extern bool threadedSimulation;
+extern bool trailsEnabled;
+extern size_t trailLength;
+extern bool offscreenRendering;
+extern unsigned frameWidth;
+extern unsigned frameHeight;
+extern size_t frameLimit;
+extern FrameExporter *frameExporter;
+extern size_t diagnosticsInterval;
+extern std::string diagnosticsLogFileName;
+extern size_t checkpointInterval;
+extern std::string checkpointFileName;
+extern size_t restartStep;
+extern size_t trajectoryInterval;
+extern TrajectoryRecorder *trajectoryRecorder;
+extern float dt;
+extern float BIG_G;
 
 // for benchmark mode
 extern std::vector<size_t> bodyNumbers;
+extern size_t benchmarkRepetitions;
+extern double benchmarkTargetWidth;
+extern double benchmarkTimeBudget;
 extern BenchmarkMode benchmark;
 std::string logFileName;
 extern PerformanceMetricsCollector *performanceMetricsCollector;
+extern PeakPerformance peakPerformance;
+
+/**
+ * @brief Measures the peak of the hardware whose steps are timed, so that the % of peak compares like with like
+ *
+ * calcSimulationStep() records the time of the CPU engine whenever it runs, also in the CPUGPU mode, in which the
+ * CPU is the reference. So the device peak only applies if the GPU engine runs alone.
+ */
+static PeakPerformance measureRecordedEnginePeak() {
+    if (useCPU) {
+        return measureHostPeak();
+    }
+    return measureDevicePeak();
+}
 
 /**
  * @brief Entry Point of the program
@@ -62,12 +117,47 @@ int main(int argc, char *argv[]) {
     boost::program_options::options_description optionDescription("Command Line Options");
     optionDescription.add_options()("N", boost::program_options::value<int>(), "Define number of bodies (added to default amount of bodies)");
     optionDescription.add_options()("Max_Mass", boost::program_options::value<std::string>(), "Maximum Mass of random bodies");
-    optionDescription.add_options()("Dataset", boost::program_options::value<std::string>(), "Name of dataset");
+    optionDescription.add_options()("Dataset", boost::program_options::value<std::string>(), "Name of dataset (Wikipedia, Plummer, Hernquist, Disk) or path of a snapshot (.nbody) or CSV file with initial conditions");
+    optionDescription.add_options()("Seed", boost::program_options::value<uint64_t>(), "Seed of the random bodies and of the validation sample; the same seed always creates the same bodies (defaults to a random seed)");
+    optionDescription.add_options()("TotalMass", boost::program_options::value<double>(), "Total mass of the Plummer, Hernquist and Disk models in kg (defaults to 2e31)");
+    optionDescription.add_options()("ScaleRadius", boost::program_options::value<double>(), "Scale radius of the Plummer, Hernquist and Disk models in m (defaults to 1e12)");
     optionDescription.add_options()("Random_Initialization", boost::program_options::value<std::string>(), "Random distribution used for initializing body positions; MUST BE 'uniform' or 'normal'");
     optionDescription.add_options()("CL_Kernel_Path", boost::program_options::value<std::string>(), "Path to OpenCL Kernel files");
     optionDescription.add_options()("Kernel", boost::program_options::value<std::string>(), "Kernel file to use");
     optionDescription.add_options()("Device", boost::program_options::value<std::string>(), "Device used for simulation; must be GPU, CPU or CPUGPU");
+    optionDescription.add_options()("ListDevices", "List all OpenCL platforms and devices and exit");
+    optionDescription.add_options()("Platform", boost::program_options::value<int>(), "Index of the OpenCL platform (see --ListDevices; defaults to searching all platforms)");
+    optionDescription.add_options()("DeviceType", boost::program_options::value<std::string>(), "Type of the OpenCL device: cpu, gpu, accelerator or all (defaults to a GPU if there is one)");
+    optionDescription.add_options()("DeviceIndex", boost::program_options::value<int>(), "Index of the OpenCL device on the selected platform (the first one if --Platform is not given) as printed by --ListDevices; without it the first device of the requested type is used");
     optionDescription.add_options()("Benchmark", boost::program_options::value<std::string>(), "Run program in benchmark mode and save results; must be either SHORT or LONG");
+    optionDescription.add_options()("MeasurePeak", "Measure the peak of the device at start-up, so that the throughput is also printed relative to it (always done in benchmark mode)");
+    optionDescription.add_options()("Sweep", boost::program_options::value<std::string>(), "Body counts used in benchmark mode as first:last:xF, first:last:+S or a comma separated list");
+    optionDescription.add_options()("Repeat", boost::program_options::value<int>(), "Number of benchmark runs per body count (defaults to 1)");
+    optionDescription.add_options()("BenchmarkCI", boost::program_options::value<double>(), "Target half width of the 95% confidence interval of the step time relative to the mean (defaults to 0.02)");
+    optionDescription.add_options()("BenchmarkBudget", boost::program_options::value<double>(), "Maximum duration of a benchmark run in seconds (defaults to 60)");
+    optionDescription.add_options()("Trace", boost::program_options::value<std::string>()->implicit_value("trace.json"), "Record a timeline of all phases and write it in the Chrome trace-event format (defaults to trace.json)");
+    optionDescription.add_options()("PerfCounters", "Count cycles, instructions, cache misses, branch misses and FP operations of the CPU force calculation (Linux only)");
+    optionDescription.add_options()("StepsPerFrame", boost::program_options::value<std::string>(), "Number of simulation steps per rendered frame or 'auto' to adapt it to the target frame rate");
+    optionDescription.add_options()("TargetFPS", boost::program_options::value<double>(), "Frame rate aimed at with --StepsPerFrame auto (defaults to 60)");
+    optionDescription.add_options()("Threaded", "Calculate the simulation on its own thread, so the window is drawn at display rate independently of the step time");
+    optionDescription.add_options()("TrailLength", boost::program_options::value<int>(), "Show trails of this number of positions per body from the start (toggled with 'T'; defaults to 32 positions)");
+    optionDescription.add_options()("Offscreen", "Render into an EGL pbuffer instead of a window, e.g. on nodes without X server; stops after --Frames frames or Ctrl+C");
+    optionDescription.add_options()("FrameSize", boost::program_options::value<std::string>(), "Size of the window or the offscreen frames in pixels as WxH (defaults to 600x400)");
+    optionDescription.add_options()("Frames", boost::program_options::value<int>(), "Number of rendered frames after which the program exits");
+    optionDescription.add_options()("RecordFrames", boost::program_options::value<std::string>(), "Export the offscreen frames as PREFIX000000.ppm, ... or pipe them as PPM stream to an encoder given as '|command'");
+    optionDescription.add_options()("Diagnostics", boost::program_options::value<std::string>(), "Log energy, momentum, center of mass and bounding box; must be given as every=K");
+    optionDescription.add_options()("CheckpointEvery", boost::program_options::value<int>(), "Write a snapshot of all bodies every K steps");
+    optionDescription.add_options()("CheckpointFile", boost::program_options::value<std::string>(), "Snapshot file written by --CheckpointEvery (defaults to checkpoint.nbody)");
+    optionDescription.add_options()("Restart", boost::program_options::value<std::string>(), "Continue the simulation from a snapshot file instead of generating bodies");
+    optionDescription.add_options()("Trajectory", boost::program_options::value<std::string>(), "Record the positions to a binary trajectory file");
+    optionDescription.add_options()("TrajectoryEvery", boost::program_options::value<int>(), "Number of steps between two recorded frames (defaults to 1)");
+    optionDescription.add_options()("TrajectoryVelocities", "Record the velocities as well");
+    optionDescription.add_options()("TrajectoryBuffers", boost::program_options::value<int>(), "Number of frames which can wait for the writer thread (defaults to 8)");
+    optionDescription.add_options()("TrajectoryPolicy", boost::program_options::value<std::string>(), "What happens if the writer falls behind: 'drop' frames (default) or 'block' the simulation");
+    optionDescription.add_options()("TrajectoryError", boost::program_options::value<double>(), "Compress the trajectory with this error bound relative to the bounding box (e.g. 1e-5)");
+    optionDescription.add_options()("TrajectoryKeyframes", boost::program_options::value<int>(), "Number of compressed frames between two keyframes (defaults to 64)");
+    optionDescription.add_options()("ValidateEvery", boost::program_options::value<int>(), "Let CPU and GPU evolve independently and compare them only every K steps (only with --Device CPUGPU)");
+    optionDescription.add_options()("ValidateSample", boost::program_options::value<int>(), "Number of randomly chosen bodies compared in the validation mode (defaults to all bodies)");
     boost::program_options::variables_map vm;
 
     try {
@@ -98,6 +188,49 @@ int main(int argc, char *argv[]) {
             return 1;
         }
     }
+    uint64_t seed = std::random_device()();
+    if (vm.count("Seed")) {
+        seed = vm["Seed"].as<uint64_t>();
+    }
+    validationSeed = seed;
+    double totalMass = 2e31;
+    double scaleRadius = 1e12;
+    if (vm.count("TotalMass")) {
+        totalMass = vm["TotalMass"].as<double>();
+    }
+    if (vm.count("ScaleRadius")) {
+        scaleRadius = vm["ScaleRadius"].as<double>();
+    }
+    if (!(totalMass > 0 && scaleRadius > 0)) {
+        std::cerr << "TotalMass and ScaleRadius must be positive.\n";
+        return 1;
+    }
+    if (vm.count("ListDevices")) {
+        listOpenClDevices(std::cout);
+        return 0;
+    }
+    if (vm.count("Platform")) {
+        clPlatformIndex = vm["Platform"].as<int>();
+        if (clPlatformIndex < 0) {
+            std::cerr << "Platform must not be negative.\n";
+            return 1;
+        }
+    }
+    if (vm.count("DeviceIndex")) {
+        clDeviceIndex = vm["DeviceIndex"].as<int>();
+        if (clDeviceIndex < 0) {
+            std::cerr << "DeviceIndex must not be negative.\n";
+            return 1;
+        }
+    }
+    if (vm.count("DeviceType")) {
+        try {
+            clDeviceType = parseDeviceType(vm["DeviceType"].as<std::string>());
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
     if (vm.count("Device")) {
         device = vm["Device"].as<std::string>();
         if (device != "CPU" && device != "GPU" && device != "CPUGPU") {
@@ -105,6 +238,104 @@ int main(int argc, char *argv[]) {
             return 2;
         }
     }
+    if (vm.count("ValidateEvery")) {
+        if (vm["ValidateEvery"].as<int>() <= 0) {
+            std::cerr << "ValidateEvery must be a positive number of steps.\n";
+            return 1;
+        }
+        validationInterval = vm["ValidateEvery"].as<int>();
+        if (device != "CPUGPU") {
+            std::cerr << "ValidateEvery is only used with --Device CPUGPU and will be ignored.\n";
+        }
+    }
+    if (vm.count("ValidateSample")) {
+        if (vm["ValidateSample"].as<int>() <= 0) {
+            std::cerr << "ValidateSample must be a positive number of bodies.\n";
+            return 1;
+        }
+        validationSampleSize = vm["ValidateSample"].as<int>();
+    }
+    if (vm.count("StepsPerFrame")) {
+        std::string steps = vm["StepsPerFrame"].as<std::string>();
+        if (steps == "auto") {
+            adaptiveStepsPerFrame = true;
+        } else {
+            std::istringstream iss(steps);
+            int k = 0;
+            if (!(iss >> k) || k <= 0) {
+                std::cerr << "StepsPerFrame must be a positive number or 'auto'.\n";
+                return 1;
+            }
+            stepsPerFrame = k;
+        }
+    }
+    if (vm.count("TargetFPS")) {
+        targetFrameRate = vm["TargetFPS"].as<double>();
+        if (targetFrameRate <= 0.0) {
+            std::cerr << "TargetFPS must be positive.\n";
+            return 1;
+        }
+    }
+    if (vm.count("Diagnostics")) {
+        std::string diagnostics = vm["Diagnostics"].as<std::string>();
+        std::istringstream iss(diagnostics.substr(diagnostics.find('=') + 1));
+        int k = 0;
+        if (diagnostics.rfind("every=", 0) != 0 || !(iss >> k) || k <= 0) {
+            std::cerr << "Diagnostics must be given as every=K with a positive number of steps K.\n";
+            return 1;
+        }
+        diagnosticsInterval = k;
+    }
+    if (vm.count("CheckpointEvery")) {
+        if (vm["CheckpointEvery"].as<int>() <= 0) {
+            std::cerr << "CheckpointEvery must be a positive number of steps.\n";
+            return 1;
+        }
+        checkpointInterval = vm["CheckpointEvery"].as<int>();
+    }
+    if (vm.count("CheckpointFile")) {
+        checkpointFileName = vm["CheckpointFile"].as<std::string>();
+    }
+    std::size_t trajectoryBuffers = 8;
+    TrajectoryPolicy trajectoryPolicy = TrajectoryPolicy::DROP;
+    if (vm.count("TrajectoryEvery")) {
+        if (vm["TrajectoryEvery"].as<int>() <= 0) {
+            std::cerr << "TrajectoryEvery must be a positive number of steps.\n";
+            return 1;
+        }
+        trajectoryInterval = vm["TrajectoryEvery"].as<int>();
+    }
+    if (vm.count("TrajectoryBuffers")) {
+        if (vm["TrajectoryBuffers"].as<int>() <= 0) {
+            std::cerr << "TrajectoryBuffers must be a positive number of frames.\n";
+            return 1;
+        }
+        trajectoryBuffers = vm["TrajectoryBuffers"].as<int>();
+    }
+    if (vm.count("TrajectoryPolicy")) {
+        std::string policy = vm["TrajectoryPolicy"].as<std::string>();
+        if (policy != "drop" && policy != "block") {
+            std::cerr << "Invalid trajectory policy given; must be 'drop' or 'block'\n";
+            return 1;
+        }
+        trajectoryPolicy = policy == "block" ? TrajectoryPolicy::BLOCK : TrajectoryPolicy::DROP;
+    }
+    double trajectoryError = 0;
+    std::size_t trajectoryKeyframes = 64;
+    if (vm.count("TrajectoryError")) {
+        trajectoryError = vm["TrajectoryError"].as<double>();
+        if (!(trajectoryError > 0 && trajectoryError < 1)) {
+            std::cerr << "TrajectoryError must be between 0 and 1.\n";
+            return 1;
+        }
+    }
+    if (vm.count("TrajectoryKeyframes")) {
+        if (vm["TrajectoryKeyframes"].as<int>() <= 0) {
+            std::cerr << "TrajectoryKeyframes must be a positive number of frames.\n";
+            return 1;
+        }
+        trajectoryKeyframes = vm["TrajectoryKeyframes"].as<int>();
+    }
     benchmark = BenchmarkMode::OFF;
     if (vm.count("Benchmark")) {
         std::string mode = vm["Benchmark"].as<std::string>();
@@ -113,6 +344,95 @@ int main(int argc, char *argv[]) {
             benchmark = BenchmarkMode::LONG;
         }
     }
+    if (vm.count("Threaded")) {
+        if (benchmark != BenchmarkMode::OFF) {
+            std::cerr << "Threaded can't be used with --Benchmark.\n";
+            return 1;
+        }
+        if (adaptiveStepsPerFrame) {
+            std::cerr << "StepsPerFrame auto is not used with --Threaded, because the frames don't wait for the steps.\n";
+            adaptiveStepsPerFrame = false;
+        }
+        threadedSimulation = true;
+    }
+    if (vm.count("TrailLength")) {
+        if (vm["TrailLength"].as<int>() < 2) {
+            std::cerr << "TrailLength must be at least 2 positions.\n";
+            return 1;
+        }
+        trailLength = vm["TrailLength"].as<int>();
+        trailsEnabled = true;
+    }
+    if (vm.count("Offscreen")) {
+        if (benchmark != BenchmarkMode::OFF) {
+            std::cerr << "Offscreen can't be used with --Benchmark.\n";
+            return 1;
+        }
+        offscreenRendering = true;
+    }
+    if (vm.count("FrameSize")) {
+        std::istringstream iss(vm["FrameSize"].as<std::string>());
+        int width = 0, height = 0;
+        char separator = 0;
+        if (!(iss >> width >> separator >> height) || separator != 'x' || width <= 0 || height <= 0) {
+            std::cerr << "FrameSize must be given as WxH with a positive width W and height H.\n";
+            return 1;
+        }
+        frameWidth = width;
+        frameHeight = height;
+    }
+    if (vm.count("Frames")) {
+        if (vm["Frames"].as<int>() <= 0) {
+            std::cerr << "Frames must be a positive number of frames.\n";
+            return 1;
+        }
+        frameLimit = vm["Frames"].as<int>();
+    }
+    if (vm.count("RecordFrames") && !offscreenRendering) {
+        std::cerr << "RecordFrames is only supported with --Offscreen, because the size of a window can change.\n";
+        return 1;
+    }
+    std::string traceFileName;
+    if (vm.count("Trace")) {
+        traceFileName = vm["Trace"].as<std::string>();
+        Trace::enable();
+    }
+    if (vm.count("PerfCounters"))
+        PerfCounters::enable();
+    bool customSweep = false;
+    if (vm.count("Sweep")) {
+        try {
+            bodyNumbers = parseSweep(vm["Sweep"].as<std::string>());
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        customSweep = true;
+    }
+    if (vm.count("Repeat")) {
+        if (vm["Repeat"].as<int>() <= 0) {
+            std::cerr << "Repeat must be a positive number of runs.\n";
+            return 1;
+        }
+        benchmarkRepetitions = vm["Repeat"].as<int>();
+    }
+    if (vm.count("BenchmarkCI")) {
+        benchmarkTargetWidth = vm["BenchmarkCI"].as<double>();
+        if (benchmarkTargetWidth <= 0.0) {
+            std::cerr << "BenchmarkCI must be positive.\n";
+            return 1;
+        }
+    }
+    if (vm.count("BenchmarkBudget")) {
+        benchmarkTimeBudget = vm["BenchmarkBudget"].as<double>();
+        if (benchmarkTimeBudget <= 0.0) {
+            std::cerr << "BenchmarkBudget must be positive.\n";
+            return 1;
+        }
+    }
+    if ((customSweep || vm.count("Repeat")) && benchmark == BenchmarkMode::OFF) {
+        std::cerr << "Sweep and Repeat are only used with --Benchmark and will be ignored.\n";
+    }
 
     if (device == "CPU") {
         useCPU = true;
@@ -130,28 +450,128 @@ int main(int argc, char *argv[]) {
     //************************
     // Data Set Initialization
     //************************
-    if (true) {
+    Model model;
+    if (vm.count("Restart")) {
+        if (benchmark != BenchmarkMode::OFF) {
+            std::cerr << "Restart can't be used with --Benchmark.\n";
+            return 1;
+        }
+        try {
+            SnapshotDataSet *snapshot = new SnapshotDataSet(vm["Restart"].as<std::string>());
+            restartStep = snapshot->getStep();
+            if (snapshot->getTimeStep() != dt) {
+                std::cerr << "The snapshot was simulated with a time step of " << snapshot->getTimeStep() << "s, continuing with " << dt << "s.\n";
+            }
+            std::cout << "Restarting from step " << restartStep << " with " << snapshot->getSize() << " bodies" << std::endl;
+            dataSet = snapshot;
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    } else if (parseModel(dataSetName, model)) {
+        if (benchmark != BenchmarkMode::OFF) {
+            std::cerr << "A model can't be used with --Benchmark.\n";
+            return 1;
+        }
+        if (N == 0) {
+            std::cerr << "Please give the number of bodies of the model with --N.\n";
+            return 1;
+        }
+        std::cout << "Seed: " << seed << std::endl;
+        dataSet = new ModelDataSet(model, N, seed, totalMass, scaleRadius, BIG_G);
+    } else if (!dataSetName.empty() && dataSetName != "Wikipedia") {
+        if (benchmark != BenchmarkMode::OFF) {
+            std::cerr << "A dataset file can't be used with --Benchmark.\n";
+            return 1;
+        }
+        try {
+            std::string fileName = dataSetName;
+            std::string extension = fileName.size() >= 4 ? fileName.substr(fileName.size() - 4) : "";
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (extension == ".csv") {
+                dataSet = loadCsvDataSet(fileName, dt, BIG_G);
+            } else {
+                dataSet = new SnapshotDataSet(fileName);
+            }
+            std::cout << "Loaded " << dataSet->getSize() << " bodies from " << fileName << std::endl;
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    } else {
+        std::cout << "Seed: " << seed << std::endl;
         if (vm.count("Max_Mass")) {
             const std::string sMaxMass = vm["Max_Mass"].as<std::string>();
             std::istringstream iss(sMaxMass);
             double maxMass;
             iss >> maxMass;
-            dataSet = new WikipediaDataSet(N, bodyInitDistribution, maxMass);
+            dataSet = new WikipediaDataSet(N, bodyInitDistribution, seed, maxMass);
+        } else {
+            dataSet = new WikipediaDataSet(N, bodyInitDistribution, seed);
+        }
+    }
+
+    if (vm.count("Trajectory")) {
+        if (benchmark != BenchmarkMode::OFF) {
+            std::cerr << "Trajectory is not recorded in benchmark mode and will be ignored.\n";
         } else {
-            dataSet = new WikipediaDataSet(N, bodyInitDistribution);
+            if (trajectoryInterval == 0)
+                trajectoryInterval = 1;
+            try {
+                trajectoryRecorder = new TrajectoryRecorder(vm["Trajectory"].as<std::string>(), dataSet->getSize(), dt,
+                                                            vm.count("TrajectoryVelocities") > 0, trajectoryBuffers, trajectoryPolicy,
+                                                            trajectoryError, trajectoryKeyframes);
+            } catch (const std::runtime_error &e) {
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
         }
     }
 
     if (benchmark == BenchmarkMode::OFF) {
+        if (diagnosticsInterval > 0)
+            diagnosticsLogFileName = initDiagnosticsLogFile("");
         int resCode = openGlInit(argc, argv);
+        if (offscreenRendering && resCode != 0) {
+            return 1;
+        }
         openClInit();
+        uploadDataSet();
         gpuInit();
+        // the microbenchmarks take a moment, so they only run if the result is printed
+        if (vm.count("MeasurePeak"))
+            peakPerformance = measureRecordedEnginePeak();
+        if (vm.count("RecordFrames")) {
+            try {
+                frameExporter = new FrameExporter(vm["RecordFrames"].as<std::string>(), frameWidth, frameHeight, 8);
+            } catch (const std::runtime_error &e) {
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
+        }
 
         // initialize performance metrics
         performanceMetricsCollector = new PerformanceMetricsCollector();
 
         //Enter Main Render Loop
-        glutMainLoop();
+        if (offscreenRendering) {
+            runOffscreenLoop();
+        } else {
+            glutMainLoop();
+        }
+        stopSimulationThread();
+
+        if (offscreenRendering) {
+            // reads back the pending frames and closes the encoder, so the context is still needed
+            delete frameExporter;
+            frameExporter = nullptr;
+            glutCleanup();
+            destroyOffscreenContext();
+        }
+
+        // writes the remaining frames and the index of the trajectory
+        delete trajectoryRecorder;
+        trajectoryRecorder = nullptr;
 
         // Freeing Memory
         delete dataSet;
@@ -159,32 +579,46 @@ int main(int argc, char *argv[]) {
         //************************************************************************
         // Run multiple benchmark steps with different number of bodies
         //************************************************************************
-        for (size_t i = 0; i < bodyNumbers.size(); ++i) {
-            if (i < 6 || benchmark == BenchmarkMode::LONG) {
-                // initialize data set
-                dataSet = new WikipediaDataSet(bodyNumbers[i], "normal");
-                std::cout << "Start benchmark iteration " << i << " with " << dataSet->getSize() << " bodies" << std::endl;
-
-                // initialize everything
-                openGlInit(argc, argv);
-                openClInit();
-                gpuInit();
+        // window, OpenGL and OpenCL contexts, shaders and kernels are created once for all iterations
+        delete dataSet;
+        openGlInit(argc, argv);
+        openClInit();
+        peakPerformance = measureRecordedEnginePeak();
+        logFileName = PerformanceMetricsCollector::initLogFile();
+        if (diagnosticsInterval > 0)
+            diagnosticsLogFileName = initDiagnosticsLogFile(logFileName);
 
-                // In the first iteration we need to initialize the CSV file to save the results
-                if (i == 0)
-                    logFileName = PerformanceMetricsCollector::initLogFile();
+        bool windowClosed = false;
+        for (size_t i = 0; i < bodyNumbers.size() && !windowClosed; ++i) {
+            // without an explicit sweep the short benchmark only uses the first six body counts
+            if (i >= 6 && benchmark == BenchmarkMode::SHORT && !customSweep) {
+                break;
+            }
+            for (size_t repetition = 0; repetition < benchmarkRepetitions; ++repetition) {
+                // initialize data set and the buffers depending on it
+                dataSet = new WikipediaDataSet(bodyNumbers[i], "normal", seed);
+                std::cout << "Start benchmark iteration " << i << " (repetition " << repetition << ") with " << dataSet->getSize() << " bodies" << std::endl;
+                uploadDataSet();
+                gpuInit();
 
                 // start benchmark iteration
-                glutMainLoop();
-                performanceMetricsCollector->writeToLogFile(logFileName, dataSet->getSize());
+                windowClosed = !runBenchmarkLoop();
+                if (windowClosed) {
+                    std::cerr << "The window has been closed, so the benchmark is aborted.\n";
+                } else {
+                    performanceMetricsCollector->writeToLogFile(logFileName, dataSet->getSize(), repetition);
+                }
 
                 // Freeing Memory
+                gpuRelease();
                 delete dataSet;
-            } else {
-                break;
+                if (windowClosed) {
+                    break;
+                }
             }
         }
     }
 
+    Trace::writeTraceFile(traceFileName);
     return 0;
 }
@@ -437,3 +437,16 @@ def plot_avg_values(_benchmark_results: Dict):
             tablefmt="latex",
         )
     )
+
+
+def plot_trajectory(positions, step: int, name: str, font_size: int = 12):
+    plt.figure(figsize=(10, 10), dpi=300)
+    plt.rcParams.update({"font.size": font_size})
+
+    plt.scatter(positions[:, 0], positions[:, 1], s=0.1, c="black", marker=".")
+    plt.xlabel("x [m]", fontsize=20)
+    plt.ylabel("y [m]", fontsize=20)
+    plt.title(f"Step {step}", fontsize=20)
+    plt.gca().set_aspect("equal")
+    plt.savefig(f"{dm.visual_folder}/{name}.png")
+    plt.close()
@@ -0,0 +1,190 @@
+"""Reader of the binary trajectory files written with ``--Trajectory``.
+
+Raw frames are memory-mapped. Compressed frames are decoded from the nearest
+keyframe on, and ``stride`` decodes only every n-th chunk of 16384 spatially
+close bodies, so a plot never has to decompress the whole file.
+"""
+from typing import Optional, Tuple
+import argparse
+import struct
+import numpy as np
+
+HEADER = struct.Struct("<8sIIQIIdQdII")
+FRAME_HEADER = struct.Struct("<QQ")
+FOOTER = struct.Struct("<QQQ8s")
+CODING = struct.Struct("<II3dd3dd")
+CHUNK_HEADER = struct.Struct("<III")
+
+HAS_VELOCITIES = 1
+COMPRESSED = 2
+PROBABILITY_BITS = 12
+RANS_LOWER_BOUND = 1 << 23
+
+Frame = Tuple[np.ndarray, np.ndarray, Optional[np.ndarray]]
+
+
+def rans_decode(coded: np.ndarray, frequencies: np.ndarray, size: int) -> np.ndarray:
+    freqs = frequencies.tolist()
+    starts = (np.cumsum(frequencies, dtype=np.int64) - frequencies).tolist()
+    symbols = np.repeat(np.arange(256), frequencies).tolist()
+    data = coded.tobytes()
+    state = int.from_bytes(data[:4], "little")
+    position = 4
+    mask = (1 << PROBABILITY_BITS) - 1
+    out = bytearray(size)
+    for i in range(size):
+        slot = state & mask
+        symbol = symbols[slot]
+        out[i] = symbol
+        state = freqs[symbol] * (state >> PROBABILITY_BITS) + slot - starts[symbol]
+        while state < RANS_LOWER_BOUND:
+            state = (state << 8) | data[position]
+            position += 1
+    return np.frombuffer(bytes(out), dtype=np.uint8)
+
+
+def varint_decode(raw: np.ndarray, count: int) -> np.ndarray:
+    ends = np.flatnonzero(raw < 0x80)
+    if len(ends) != count:
+        raise ValueError("Malformed chunk in compressed trajectory")
+    if count == 0:
+        return np.zeros(0, dtype=np.int64)
+    starts = np.concatenate(([0], ends[:-1] + 1))
+    group = np.repeat(np.arange(count), ends - starts + 1)
+    shifts = ((np.arange(len(raw)) - starts[group]) * 7).astype(np.uint64)
+    # the 7-bit groups don't overlap, so summing them is the same as or-ing them
+    values = np.add.reduceat((raw & 0x7F).astype(np.uint64) << shifts, starts)
+    return (values >> np.uint64(1)).astype(np.int64) ^ -(values & np.uint64(1)).astype(np.int64)
+
+
+class TrajectoryReader:
+    def __init__(self, path: str):
+        self.data = np.memmap(path, dtype=np.uint8, mode="r")
+        if len(self.data) < HEADER.size:
+            raise ValueError(f"{path} is not a trajectory file")
+        (magic, version, header_size, self.nbody, flags, _, self.dt, self.frame_bytes,
+         self.relative_error, self.keyframe_interval, self.chunk_bodies) = HEADER.unpack_from(self.data, 0)
+        if magic != b"NBODYTRJ":
+            raise ValueError(f"{path} is not a trajectory file")
+        if version != 2:
+            raise ValueError(f"{path} has trajectory version {version}, expected 2")
+        self.header_size = header_size
+        self.velocities = bool(flags & HAS_VELOCITIES)
+        self.compressed = bool(flags & COMPRESSED)
+        self.components = 6 if self.velocities else 3
+        if self.compressed:
+            self.chunk_count = (self.nbody + self.chunk_bodies - 1) // self.chunk_bodies
+        self.steps, self.offsets, self.dropped_frames = self._read_index()
+        self._state = None
+
+    def _read_index(self) -> Tuple[np.ndarray, np.ndarray, int]:
+        if len(self.data) >= self.header_size + FOOTER.size:
+            frame_count, index_offset, dropped, magic = FOOTER.unpack_from(self.data, len(self.data) - FOOTER.size)
+            if magic == b"NBODYIDX" and index_offset + 16 * frame_count + FOOTER.size == len(self.data):
+                index = np.frombuffer(self.data, dtype=np.uint64, count=2 * frame_count, offset=index_offset)
+                return index[0::2].astype(np.int64), index[1::2].astype(np.int64), dropped
+        # no footer (e.g. the simulation crashed): walk the frames
+        steps, offsets = [], []
+        offset = self.header_size
+        while offset + FRAME_HEADER.size <= len(self.data):
+            step, payload_bytes = FRAME_HEADER.unpack_from(self.data, offset)
+            if offset + FRAME_HEADER.size + payload_bytes > len(self.data):
+                break
+            steps.append(step)
+            offsets.append(offset)
+            offset += FRAME_HEADER.size + payload_bytes
+        return np.array(steps, dtype=np.int64), np.array(offsets, dtype=np.int64), 0
+
+    def __len__(self) -> int:
+        return len(self.steps)
+
+    def frame(self, i: int, stride: int = 1) -> Frame:
+        """Returns the body indices, positions (N x 3) and velocities (N x 3 or None) of frame i.
+
+        With a stride > 1 only every stride-th body (raw) or chunk of spatially close bodies (compressed) is read.
+        """
+        if i < 0:
+            i += len(self)
+        if self.compressed:
+            return self._compressed_frame(i, stride)
+        payload = self.offsets[i] + FRAME_HEADER.size
+        floats = np.frombuffer(self.data, dtype=np.float32, count=self.components * self.nbody, offset=payload)
+        indices = np.arange(0, self.nbody, stride)
+        positions = floats[: 3 * self.nbody].reshape(-1, 3)[indices]
+        velocities = floats[3 * self.nbody:].reshape(-1, 3)[indices] if self.velocities else None
+        return indices, positions, velocities
+
+    def _is_keyframe(self, i: int) -> bool:
+        return CODING.unpack_from(self.data, self.offsets[i] + FRAME_HEADER.size)[0] == 1
+
+    def _compressed_frame(self, i: int, stride: int) -> Frame:
+        chunks = range(0, self.chunk_count, stride)
+        keyframe = i
+        while not self._is_keyframe(keyframe):
+            keyframe -= 1
+            if keyframe < 0:
+                raise ValueError("Compressed trajectory doesn't start with a keyframe")
+        # sequential reads continue from the last decoded frame
+        start = keyframe
+        coding = permutation = values = None
+        if self._state is not None and self._state[1] == stride and keyframe <= self._state[0] <= i:
+            start = self._state[0] + 1
+            _, _, coding, permutation, values = self._state
+        for j in range(start, i + 1):
+            coding, permutation, values = self._decode(j, chunks, permutation if j > keyframe else None,
+                                                       values if j > keyframe else None)
+        self._state = (i, stride, coding, permutation, values)
+
+        indices = np.concatenate([permutation[c] for c in chunks])
+        quantized = np.concatenate([values[c] for c in chunks], axis=1).astype(np.float64)
+        positions = (np.array(coding[2:5])[:, None] + coding[5] * quantized[:3]).T.astype(np.float32)
+        velocities = None
+        if self.velocities:
+            velocities = (np.array(coding[6:9])[:, None] + coding[9] * quantized[3:]).T.astype(np.float32)
+        return indices, positions, velocities
+
+    def _decode(self, i, chunks, permutation, values):
+        position = self.offsets[i] + FRAME_HEADER.size
+        coding = CODING.unpack_from(self.data, position)
+        position += CODING.size
+        keyframe = coding[0] == 1
+        if keyframe:
+            position, order = self._decode_stream(position, chunks, 1)
+            permutation = {c: np.cumsum(order[c][0]) for c in chunks}
+        position, deltas = self._decode_stream(position, chunks, self.components)
+        if keyframe:
+            values = {c: np.cumsum(deltas[c], axis=1) for c in chunks}
+        else:
+            values = {c: values[c] + deltas[c] for c in chunks}
+        return coding, permutation, values
+
+    def _decode_stream(self, position, chunks, components):
+        sizes = np.frombuffer(self.data, dtype=np.uint32, count=self.chunk_count, offset=position).astype(np.int64)
+        offsets = position + 4 * self.chunk_count + np.concatenate(([0], np.cumsum(sizes)))
+        decoded = {}
+        for c in chunks:
+            count = min(self.chunk_bodies, self.nbody - c * self.chunk_bodies)
+            raw_bytes, coded_bytes, mode = CHUNK_HEADER.unpack_from(self.data, offsets[c])
+            payload = offsets[c] + CHUNK_HEADER.size
+            if mode == 1:
+                frequencies = np.frombuffer(self.data, dtype=np.uint16, count=256, offset=payload)
+                coded = self.data[payload + 512: payload + 512 + coded_bytes]
+                raw = rans_decode(coded, frequencies, raw_bytes)
+            else:
+                raw = np.asarray(self.data[payload: payload + raw_bytes])
+            decoded[c] = varint_decode(raw, components * count).reshape(components, count)
+        return offsets[-1], decoded
+
+
+if __name__ == "__main__":
+    from plot import plot_trajectory
+
+    parser = argparse.ArgumentParser(description="Plots a frame of a trajectory file")
+    parser.add_argument("file", help="trajectory written with --Trajectory")
+    parser.add_argument("--frame", type=int, default=-1, help="frame to plot (defaults to the last one)")
+    parser.add_argument("--stride", type=int, default=1, help="read only every n-th body or chunk")
+    args = parser.parse_args()
+
+    reader = TrajectoryReader(args.file)
+    _, frame_positions, _ = reader.frame(args.frame, args.stride)
+    plot_trajectory(frame_positions, int(reader.steps[args.frame]), f"trajectory_{reader.steps[args.frame]}")